@@ -34,25 +34,6 @@ void vc_timer(void) {
 
 
 
-/**
- * @brief Converte uma imagem de BGR para RGB
- *
- * @author lugon
- * @param src Imagem de entrada no formato BGR
- * @return IVC* Imagem convertida no formato RGB
- */
-IVC* convertBGRToRGB(IVC* src) {
-    IVC* dst = vc_image_new(src->width, src->height, src->channels, src->levels);
-    int size = src->width * src->height * src->channels;
-    for (int i = 0; i < size; i += src->channels) {
-        dst->data[i] = src->data[i + 2];
-        dst->data[i + 1] = src->data[i + 1];
-        dst->data[i + 2] = src->data[i];
-    }
-    return dst;
-}
-
-
 /**
  * @brief Calcula a distância euclidiana entre dois pontos
  *
@@ -67,22 +48,30 @@ double euclideanDistance(const cv::Point& pt1, const cv::Point& pt2) {
 
 
 /**
- * @brief Segmenta a cor utilizando a biblioteca vc.c
+ * @brief Converte os contornos exteriores de um conjunto de contornos em listas de pontos do OpenCV
  *
  * @author lugon
- * @param src Imagem de entrada no formato HSV
- * @param minHue Valor mínimo do matiz
- * @param maxHue Valor máximo do matiz
- * @param minSaturation Valor mínimo da saturação
- * @param maxSaturation Valor máximo da saturação
- * @param minValue Valor mínimo do valor
- * @param maxValue Valor máximo do valor
- * @return IVC* Imagem segmentada
+ * @param set Contornos devolvidos por vc_contours_trace
+ * @param blobs Blobs da imagem de etiquetas (blobs[i].label = i + 1)
+ * @param regions Blob de cada contorno devolvido, pela mesma ordem
+ * @return std::vector<std::vector<cv::Point>> Vértices do contorno exterior de cada blob
  */
-IVC* segmentColor(IVC* src, unsigned char minHue, unsigned char maxHue, unsigned char minSaturation, unsigned char maxSaturation, unsigned char minValue, unsigned char maxValue) {
-    IVC* dst = vc_image_new(src->width, src->height, 1, 255);
-    vc_hsv_segmentation(src, dst, minHue, maxHue, minSaturation, maxSaturation, minValue, maxValue);
-    return dst;
+std::vector<std::vector<cv::Point>> contoursToPoints(const CSVC* set, const OVC* blobs, std::vector<OVC>& regions) {
+    std::vector<std::vector<cv::Point>> contours;
+    contours.reserve(set->ncontours);
+    regions.clear();
+    for (int i = 0; i < set->ncontours; i++) {
+        const CVC& c = set->contours[i];
+        if (c.hole) continue;
+        const int* p = set->points + 2 * c.first;
+        std::vector<cv::Point> contour(c.npoints);
+        for (int k = 0; k < c.npoints; k++) {
+            contour[k] = cv::Point(p[2 * k], p[2 * k + 1]);
+        }
+        contours.push_back(std::move(contour));
+        regions.push_back(blobs[c.label - 1]);
+    }
+    return contours;
 }
 
 /**
@@ -135,55 +124,6 @@ const std::vector<ColorRange> colorRanges = {
     {cv::Scalar(0, 0, 200), cv::Scalar(180, 50, 255), "Branco", 9},
 };
 
-/**
- * @brief Converte uma imagem de BGR para HSV
- *
- * @author lugon
- * @param bgr Imagem de entrada no formato BGR
- * @param hsv Imagem de saída no formato HSV
- */
-void convertBGRToHSV(cv::Mat& bgr, cv::Mat& hsv) {
-    hsv.create(bgr.size(), bgr.type());
-    for (int y = 0; y < bgr.rows; ++y) {
-        for (int x = 0; x < bgr.cols; ++x) {
-            cv::Vec3b bgrPixel = bgr.at<cv::Vec3b>(y, x);
-            float blue = bgrPixel[0] / 255.0;
-            float green = bgrPixel[1] / 255.0;
-            float red = bgrPixel[2] / 255.0;
-
-            float cmax = std::max({ red, green, blue });
-            float cmin = std::min({ red, green, blue });
-            float delta = cmax - cmin;
-
-            float h = 0, s = 0, v = 0;
-            v = cmax;
-
-            if (cmax != 0)
-                s = delta / cmax;
-            else
-                s = 0;
-
-            if (delta != 0) {
-                if (cmax == red)
-                    h = 60 * (fmod(((green - blue) / delta), 6));
-                else if (cmax == green)
-                    h = 60 * (((blue - red) / delta) + 2);
-                else if (cmax == blue)
-                    h = 60 * (((red - green) / delta) + 4);
-            }
-            else
-                h = 0;
-
-            if (h < 0)
-                h += 360;
-
-            hsv.at<cv::Vec3b>(y, x)[0] = static_cast<unsigned char>((h / 2));
-            hsv.at<cv::Vec3b>(y, x)[1] = static_cast<unsigned char>((s * 255));
-            hsv.at<cv::Vec3b>(y, x)[2] = static_cast<unsigned char>((v * 255));
-        }
-    }
-}
-
 /**
  * @brief Calcula a média da cor em uma região da imagem
  *
@@ -244,7 +184,15 @@ double minDistance(const std::vector<cv::Point>& contour1, const std::vector<cv:
 }
 
 
-void mergeCloseContours(std::vector<std::vector<cv::Point>>& contours, double maxDist) {
+/**
+ * @brief Junta os contornos próximos (e os respetivos blobs, somando os momentos)
+ *
+ * @author lugon
+ * @param contours Contornos a juntar
+ * @param regions Blob de cada contorno, pela mesma ordem
+ * @param maxDist Distância abaixo da qual dois contornos são juntados
+ */
+void mergeCloseContours(std::vector<std::vector<cv::Point>>& contours, std::vector<OVC>& regions, double maxDist) {
     bool merged;
     do {
         merged = false;
@@ -254,6 +202,8 @@ void mergeCloseContours(std::vector<std::vector<cv::Point>>& contours, double ma
                 if (dist < maxDist) {
                     contours[i].insert(contours[i].end(), contours[j].begin(), contours[j].end());
                     contours.erase(contours.begin() + j);
+                    vc_blob_merge(&regions[i], &regions[j]);
+                    regions.erase(regions.begin() + j);
                     merged = true;
                     break;
                 }
@@ -373,6 +323,91 @@ void drawCircle(cv::Mat& img, cv::Point center, int radius, const cv::Scalar& co
 }
 
 
+/**
+ * @brief Deteta os blobs amarelos (corpos das resistências) na imagem reduzida
+ *
+ * @author lugon
+ * @param ivc_detect Imagem BGR na resolução de deteção
+ * @param yellow Intervalo HSV da cor amarela
+ * @param runs Segmentos (reutilizados entre frames)
+ * @param blobs Blobs (reutilizados entre frames)
+ * @param labels Etiquetas da máscara final (reutilizadas entre frames)
+ * @param contourSet Contornos da máscara final (reutilizados entre frames)
+ * @param morphFrame Máscara após as operações morfológicas, para exibir
+ * @param contours Vértices do contorno exterior de cada blob encontrado
+ * @param regions Blob de cada contorno (caixa, momentos e orientação), pela mesma ordem
+ * @return bool false se alguma operação morfológica falhou
+ */
+bool detectYellowBlobs(IVC* ivc_detect, RVC& yellow, std::vector<RLVC>& runs, std::vector<OVC>& blobs, std::vector<int>& labels, CSVC* contourSet, cv::Mat& morphFrame, std::vector<std::vector<cv::Point>>& contours, std::vector<OVC>& regions) {
+    // Converter o frame reduzido para HSV, lendo diretamente os canais em BGR
+    IVC* ivc_hsv = vc_image_new(ivc_detect->width, ivc_detect->height, ivc_detect->channels, ivc_detect->levels);
+    vc_bgr_to_hsv(ivc_detect, ivc_hsv);
+
+    // Segmentar a cor amarela diretamente em segmentos e blobs, sem escrever a máscara
+    size_t maxRuns = (size_t)ivc_detect->height * ((ivc_detect->width + 1) / 2);
+    if (runs.size() < maxRuns) {
+        runs.resize(maxRuns);
+        blobs.resize(maxRuns);
+    }
+    int nruns = 0, nblobs = 0;
+    vc_hsv_segmentation_runs(ivc_hsv, &yellow, 1, runs.data(), blobs.data(), (int)maxRuns, &nruns, &nblobs);
+
+    contours.clear();
+    regions.clear();
+    if (nblobs == 0) {
+        // Sem amarelo: não há máscara, morfologia nem contornos a calcular
+        morphFrame = cv::Mat::zeros(ivc_hsv->height, ivc_hsv->width, CV_8UC1);
+    }
+    else {
+        // Desenhar a máscara a partir dos segmentos, para as operações morfológicas
+        IVC* maskYellow = vc_image_new(ivc_hsv->width, ivc_hsv->height, 1, 255);
+        vc_runs_to_binary(maskYellow, runs.data(), nruns);
+
+        // Erosão (3) seguida de dilatação (5), com uma leitura e uma escrita da máscara:
+        // as duas operações são feitas sobre a máscara compactada em bits
+        IVC* dilatedMask = vc_image_new(maskYellow->width, maskYellow->height, maskYellow->channels, maskYellow->levels);
+        int morphOps[2] = { VC_MORPH_ERODE, VC_MORPH_DILATE };
+        int morphKernels[2] = { 3, 5 };
+        if (!vc_binary_morphology_sequence(maskYellow, dilatedMask, morphOps, morphKernels, 2)) {
+            std::cerr << "Erro ao aplicar erosão/dilatação!" << std::endl;
+            // Liberar memória e sair
+            vc_image_free(maskYellow);
+            vc_image_free(dilatedMask);
+            vc_image_free(ivc_hsv);
+            return false;
+        }
+
+        // Preencher os buracos do corpo (reflexos e bandas rodeadas de amarelo), para que cada
+        // resistência dê um só blob sem dilatações grandes
+        if (!vc_binary_fill_holes(dilatedMask, dilatedMask)) {
+            std::cerr << "Erro ao preencher os buracos da máscara!" << std::endl;
+            vc_image_free(maskYellow);
+            vc_image_free(dilatedMask);
+            vc_image_free(ivc_hsv);
+            return false;
+        }
+
+        // Converter a imagem processada de volta para cv::Mat para exibir
+        morphFrame = convertIVCToMat(dilatedMask);
+
+        // Etiquetar a máscara final (com a área, os momentos e a orientação de cada blob, na mesma
+        // passagem) e seguir o contorno exterior de cada blob, sem passar pelo OpenCV
+        labels.resize((size_t)dilatedMask->width * dilatedMask->height);
+        OVC* finalBlobs = NULL;
+        if (vc_binary_blob_labelling_parallel(dilatedMask, labels.data(), 0, &finalBlobs) > 0 &&
+            vc_contours_trace(contourSet, labels.data(), dilatedMask->width, dilatedMask->height, 0, 1) > 0) {
+            contours = contoursToPoints(contourSet, finalBlobs, regions);
+        }
+        free(finalBlobs);
+
+        vc_image_free(maskYellow);
+        vc_image_free(dilatedMask);
+    }
+
+    vc_image_free(ivc_hsv);
+    return true;
+}
+
 int main(void) {
     // Nome do arquivo de vídeo
     char videofile[20] = "video_resistors.mp4";
@@ -417,9 +452,34 @@ int main(void) {
     vc_timer();
 
     // Definir intervalos de cor para segmentação da cor amarela
-    unsigned char minHue = 25, maxHue = 30; // Intervalo para a cor amarela
-    unsigned char minSaturation = 105, maxSaturation = 255;
-    unsigned char minValue = 100, maxValue = 255;
+    RVC yellow;
+    yellow.minHue = 25; yellow.maxHue = 30; // Intervalo para a cor amarela
+    yellow.minSaturation = 105; yellow.maxSaturation = 255;
+    yellow.minValue = 100; yellow.maxValue = 255;
+
+    // Segmentos e blobs da segmentação (reservados uma vez para o pior caso da resolução de deteção)
+    std::vector<RLVC> runs;
+    std::vector<OVC> blobs;
+
+    // Etiquetas e contornos da máscara final (os pontos de todos os contornos ficam num único array)
+    std::vector<int> labels;
+    CSVC* contourSet = vc_contours_new();
+
+    // Deteção em pirâmide: a segmentação, a morfologia e os contornos são calculados a 1/2^detectLevel
+    // da resolução (0 = resolução completa, 2 = 1/4, 3 = 1/8). Só as caixas delimitadoras encontradas,
+    // ampliadas para a resolução original, são processadas à resolução completa.
+    const int detectLevel = 2;
+    const int detectScale = 1 << detectLevel;
+
+    // Salto de frames sem mudanças: a frame reduzida é comparada por blocos com a da última deteção e,
+    // se nenhum bloco mudou (diferença média por byte até tileThreshold), a frame inteira é saltada e as
+    // deteções anteriores são reutilizadas. Basta um bloco alterado para a deteção ser refeita na frame toda.
+    const int tileSize = 16;
+    const int tileThreshold = 4;
+    IVC* prevDetect = NULL;
+    cv::Mat prevMorphFrame;
+    std::vector<std::vector<cv::Point>> prevContours;
+    std::vector<OVC> prevRegions;
 
     cv::Mat frame;
     while (key != 'q') {
@@ -432,77 +492,119 @@ int main(void) {
         // Número da frame a processar
         video.nframe = (int)capture.get(cv::CAP_PROP_POS_FRAMES);
 
-        // Converter o frame para a estrutura IVC
-        IVC* ivc_frame_bgr = convertMatToIVC(frame);
-        IVC* ivc_frame = convertBGRToRGB(ivc_frame_bgr); // Converter BGR para RGB
-
-        // Converter o frame para HSV
-        IVC* ivc_hsv = vc_image_new(ivc_frame->width, ivc_frame->height, ivc_frame->channels, ivc_frame->levels);
-        vc_rgb_to_hsv(ivc_frame, ivc_hsv);
+        // Converter o frame para a estrutura IVC (mantém a ordem BGR do OpenCV)
+        IVC* ivc_frame = convertMatToIVC(frame);
 
-        // Segmentar a cor amarela
-        IVC* maskYellow = segmentColor(ivc_hsv, minHue, maxHue, minSaturation, maxSaturation, minValue, maxValue);
-
-        // Criar imagens para operações morfológicas
-        IVC* dilatedMask = vc_image_new(maskYellow->width, maskYellow->height, maskYellow->channels, maskYellow->levels);
-        IVC* erodedMask = vc_image_new(dilatedMask->width, dilatedMask->height, dilatedMask->channels, dilatedMask->levels);
-
-        // Aplicar erosão
-        if (!vc_binary_erode(maskYellow, erodedMask, 3)) {
-            std::cerr << "Erro ao aplicar erosão!" << std::endl;
-            // Liberar memória e sair
-            vc_image_free(dilatedMask);
-            vc_image_free(erodedMask);
+        // Reduzir o frame para a resolução de deteção (decimação por área 2x2 por nível)
+        IVC* pyramid[VC_PYRAMID_MAX_LEVELS];
+        if (!vc_pyramid_build(ivc_frame, pyramid, detectLevel + 1, 0)) {
+            std::cerr << "Erro ao construir a pirâmide!" << std::endl;
+            vc_image_free(ivc_frame);
+            vc_image_free(prevDetect);
+            vc_contours_free(contourSet);
             return 1;
         }
+        IVC* ivc_detect = pyramid[detectLevel];
 
-        // Aplicar dilatação
-        if (!vc_binary_dilate(erodedMask, dilatedMask, 5)) {
-            std::cerr << "Erro ao aplicar dilatação!" << std::endl;
-            // Liberar memória e sair
-            vc_image_free(dilatedMask);
-            vc_image_free(erodedMask);
-            return 1;
+        // Contar os blocos da frame reduzida que mudaram desde a última deteção (só interessa se há algum)
+        int ndirty = -1;
+        if (prevDetect != NULL) {
+            if (!vc_image_tile_changes(ivc_detect, prevDetect, tileSize, tileThreshold, NULL, &ndirty)) ndirty = -1;
         }
 
-        // Converter a imagem processada de volta para cv::Mat para exibir
-        cv::Mat morphFrame = convertIVCToMat(dilatedMask);
-
-        // Encontrar blobs na máscara segmentada usando OpenCV
+        cv::Mat morphFrame;
         std::vector<std::vector<cv::Point>> contours;
-        cv::findContours(morphFrame, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+        std::vector<OVC> regions;
+        if (ndirty == 0) {
+            // A câmara é fixa e nenhum bloco mudou: saltar a frame e reutilizar as deteções anteriores
+            morphFrame = prevMorphFrame;
+            contours = prevContours;
+            regions = prevRegions;
+        }
+        else {
+            if (!detectYellowBlobs(ivc_detect, yellow, runs, blobs, labels, contourSet, morphFrame, contours, regions)) {
+                vc_pyramid_free(pyramid, detectLevel + 1);
+                vc_image_free(ivc_frame);
+                vc_image_free(prevDetect);
+                vc_contours_free(contourSet);
+                return 1;
+            }
 
-        // Unir contornos próximos para formar um único contorno por resistência
-        const double maxDist = 200; // Distância máxima para agrupar contornos
-        mergeCloseContours(contours, maxDist);
+            // Unir contornos próximos para formar um único contorno por resistência
+            const double maxDist = 200; // Distância máxima para agrupar contornos (na resolução original)
+            mergeCloseContours(contours, regions, maxDist / detectScale);
 
-        // Processar cada contorno agrupado
-        for (const auto& contour : contours) {
-            cv::Rect boundingBox = cv::boundingRect(contour);
+            // Guardar a frame e as deteções para as frames seguintes
+            if (prevDetect == NULL) prevDetect = vc_image_new(ivc_detect->width, ivc_detect->height, ivc_detect->channels, ivc_detect->levels);
+            memcpy(prevDetect->data, ivc_detect->data, (size_t)ivc_detect->width * ivc_detect->height * ivc_detect->channels);
+            prevMorphFrame = morphFrame;
+            prevContours = contours;
+            prevRegions = regions;
+        }
 
-            drawRectangle(frame, boundingBox, cv::Scalar(0, 0, 255), 2);
+        // Processar cada contorno agrupado
+        for (size_t k = 0; k < contours.size(); k++) {
+            const auto& contour = contours[k];
+
+            // Ampliar a caixa delimitadora para a resolução original
+            cv::Rect detectBox = cv::boundingRect(contour);
+            cv::Rect boundingBox = cv::Rect(detectBox.x * detectScale, detectBox.y * detectScale, detectBox.width * detectScale, detectBox.height * detectScale) & cv::Rect(0, 0, frame.cols, frame.rows);
+
+            // Converter apenas a região da resistência para HSV na escala do OpenCV (Hue em [0,180]),
+            // antes de desenhar, para comparar as bandas com os intervalos de colorRanges
+            IVC* ivc_roi = vc_image_crop(ivc_frame, boundingBox.x, boundingBox.y, boundingBox.width, boundingBox.height);
+            if (ivc_roi == NULL) continue;
+            IVC* ivc_roi_hsv = vc_image_new(ivc_roi->width, ivc_roi->height, ivc_roi->channels, ivc_roi->levels);
+            vc_bgr_to_hsv_180(ivc_roi, ivc_roi_hsv);
+            cv::Mat hsvRoi(ivc_roi_hsv->height, ivc_roi_hsv->width, CV_8UC3, ivc_roi_hsv->data);
+
+            // Caixa orientada da resistência (a partir dos momentos do blob), ampliada para a resolução
+            // original: as bandas são procuradas ao longo do eixo maior, mesmo com a resistência inclinada
+            float corners[8], length, thickness;
+            if (!vc_blob_oriented_box(&regions[k], corners, &length, &thickness)) {
+                vc_image_free(ivc_roi);
+                vc_image_free(ivc_roi_hsv);
+                continue;
+            }
+            for (int c = 0; c < 8; c++) corners[c] = (corners[c] + 0.5f) * detectScale - 0.5f;
+            length *= detectScale;
+            thickness *= detectScale;
+            float cx = (corners[0] + corners[4]) / 2, cy = (corners[1] + corners[5]) / 2;
+            float ux = std::cos(regions[k].angle), uy = std::sin(regions[k].angle);
+
+            for (int c = 0; c < 4; c++) {
+                int d = (c + 1) % 4;
+                drawLine(frame, cv::Point(cvRound(corners[2 * c]), cvRound(corners[2 * c + 1])), cv::Point(cvRound(corners[2 * d]), cvRound(corners[2 * d + 1])), cv::Scalar(0, 0, 255), 2);
+            }
 
-            // Dividir o retângulo delimitador em 10 partes iguais e desenhar apenas as linhas 2, 3, 4, 5, 6 e 7
-            int partWidth = boundingBox.width / 10;
+            // Dividir a caixa orientada em 10 partes iguais ao longo do eixo maior e desenhar apenas as linhas 2, 3, 4, 5, 6 e 7
             for (int i = 2; i <= 7; i++) {
-                int x = boundingBox.x + i * partWidth;
-                drawLine(frame, cv::Point(x, boundingBox.y), cv::Point(x, boundingBox.y + boundingBox.height), cv::Scalar(0, 255, 0), 2);
+                float t = (i / 10.0f - 0.5f) * length;
+                cv::Point p1(cvRound(cx + t * ux + thickness / 2 * uy), cvRound(cy + t * uy - thickness / 2 * ux));
+                cv::Point p2(cvRound(cx + t * ux - thickness / 2 * uy), cvRound(cy + t * uy + thickness / 2 * ux));
+                drawLine(frame, p1, p2, cv::Scalar(0, 255, 0), 2);
             }
 
-            // Converter o frame para HSV
-            cv::Mat hsvFrame;
-            convertBGRToHSV(frame, hsvFrame);
-
-            // Extrair as cores das partes 2, 3 e 4
-            cv::Scalar color1 = getCenterColorHSV(hsvFrame, cv::Rect(boundingBox.x + 2 * partWidth, boundingBox.y, partWidth, boundingBox.height));
-            cv::Scalar color2 = getCenterColorHSV(hsvFrame, cv::Rect(boundingBox.x + 4 * partWidth, boundingBox.y, partWidth, boundingBox.height));
-            cv::Scalar color3 = getCenterColorHSV(hsvFrame, cv::Rect(boundingBox.x + 6 * partWidth, boundingBox.y, partWidth, boundingBox.height));
+            // Pontos centrais das partes 2, 4 e 6, no eixo maior
+            cv::Point centers[3];
+            for (int i = 0; i < 3; i++) {
+                float t = ((2 * i + 2.5f) / 10.0f - 0.5f) * length;
+                centers[i] = cv::Point(cvRound(cx + t * ux), cvRound(cy + t * uy));
+            }
+            cv::Point center1 = centers[0], center2 = centers[1], center3 = centers[2];
+
+            // Extrair as cores nesses pontos (coordenadas relativas à região, limitadas à região)
+            cv::Scalar bandColors[3];
+            for (int i = 0; i < 3; i++) {
+                int px = std::min(std::max(centers[i].x - boundingBox.x, 0), boundingBox.width - 1);
+                int py = std::min(std::max(centers[i].y - boundingBox.y, 0), boundingBox.height - 1);
+                bandColors[i] = getCenterColorHSV(hsvRoi, cv::Rect(px, py, 1, 1));
+            }
+            cv::Scalar color1 = bandColors[0], color2 = bandColors[1], color3 = bandColors[2];
+            vc_image_free(ivc_roi);
+            vc_image_free(ivc_roi_hsv);
 
             // Adicionar pontos centrais na imagem para visualização
-            cv::Point center1(boundingBox.x + 2 * partWidth + partWidth / 2, boundingBox.y + boundingBox.height / 2);
-            cv::Point center2(boundingBox.x + 4 * partWidth + partWidth / 2, boundingBox.y + boundingBox.height / 2);
-            cv::Point center3(boundingBox.x + 6 * partWidth + partWidth / 2, boundingBox.y + boundingBox.height / 2);
-
             drawCircle(frame, center1, 3, cv::Scalar(0, 0, 0), -1);
             drawCircle(frame, center2, 3, cv::Scalar(0, 0, 0), -1);
             drawCircle(frame, center3, 3, cv::Scalar(0, 0, 0), -1);
@@ -548,17 +650,17 @@ int main(void) {
         cv::imshow("VC - VIDEO PROCESSADO", morphFrame);
 
         // Liberar memória das estruturas IVC
-        vc_image_free(ivc_frame_bgr);
+        vc_pyramid_free(pyramid, detectLevel + 1);
         vc_image_free(ivc_frame);
-        vc_image_free(ivc_hsv);
-        vc_image_free(maskYellow);
-        vc_image_free(dilatedMask);
-        vc_image_free(erodedMask);
 
         // Sair do loop se a tecla 'q' for pressionada
         key = cv::waitKey(1);
     }
 
+    // Liberar a frame da última deteção e os contornos
+    vc_image_free(prevDetect);
+    vc_contours_free(contourSet);
+
     // Para o timer e exibe o tempo decorrido
     vc_timer();
 
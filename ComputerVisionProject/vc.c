@@ -16,6 +16,36 @@
 #include "vc.h"
 #include <math.h>
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+// Extensões SIMD disponíveis, detetadas a partir das opções do compilador
+// (/arch:AVX2 no MSVC, -mssse3/-mavx2 ou -march=native no GCC/Clang).
+// Todas as funções vetorizadas têm um caminho escalar com o mesmo resultado.
+#if defined(__AVX2__)
+#define VC_AVX2
+#endif
+#if defined(__SSSE3__) || defined(__AVX__) || defined(VC_AVX2)
+#define VC_SSSE3
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)) || defined(VC_SSSE3)
+#define VC_SSE2
+#endif
+
+#if defined(VC_AVX2)
+#include <immintrin.h>
+#elif defined(VC_SSSE3)
+#include <tmmintrin.h>
+#elif defined(VC_SSE2)
+#include <emmintrin.h>
+#endif
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 // Funções para Alocação e Liberação de Memória de Imagens
 // =======================================================================
@@ -414,38 +444,90 @@ int vc_write_image(char* filename, IVC* image)
  */
 int vc_gray_negative(IVC* srcdst)
 {
-	unsigned char* data = (unsigned char*)srcdst->data; // Ponteiro para os dados da imagem
-	int width = srcdst->width;  // Largura da imagem
-	int height = srcdst->height; // Altura da imagem
-	int bytesperline = srcdst->bytesperline; // Número de bytes por linha na imagem
-	int channels = srcdst->channels; // Número de canais de cor na imagem, deve ser 1 para imagens em escala de cinza
-	int x, y; // Variáveis para iterar sobre os pixels da imagem
-	long int pos; // Posição do pixel na array de dados
+	LVC lut;
 
 	// Verificação de erros
-	if ((width <= 0) || (height <= 0) || (srcdst->data == NULL))
+	if ((srcdst->width <= 0) || (srcdst->height <= 0) || (srcdst->data == NULL))
 		return 0; // Retorna 0 se a imagem tiver dimensões inválidas ou dados nulos
 
-	if (channels != 1)
+	if (srcdst->channels != 1)
 		return 0; // Retorna 0 se a imagem não for em escala de cinza
 
-	// Processo de inverter a imagem em escala de cinza
-	for (y = 0; y < height; y++)
+	// Negativo: 255 - v, aplicado numa única passagem pela tabela de consulta
+	vc_lut_identity(&lut);
+	vc_lut_negative(&lut);
+
+	return vc_gray_apply_lut(srcdst, srcdst, &lut);
+}
+
+// Índices dos canais R, G e B para cada ordem suportada.
+// Os kernels de cor recebem estes índices como constantes, sendo instanciados
+// pelas macros VC_*_IMPL para cada combinação de ordem de canais e escala de Hue.
+#define VC_RGB_R 0
+#define VC_RGB_G 1
+#define VC_RGB_B 2
+#define VC_BGR_R 2
+#define VC_BGR_G 1
+#define VC_BGR_B 0
+
+// Segmentação HSV por tabelas: cada canal tem uma tabela de 256 máscaras, em que o bit r está ativo
+// se o nível pertence ao intervalo r nesse canal. A máscara do pixel é o AND das três tabelas, pelo
+// que o custo por pixel (3 consultas e 2 ANDs) não depende do número de intervalos.
+static void vc_hsv_mask_run(unsigned char* datasrc, unsigned char* datadst, long int npixels, unsigned char th[256], unsigned char ts[256], unsigned char tv[256])
+{
+	long int i;
+
+	for (i = 0; i < npixels; i++, datasrc += 3)
 	{
-		for (x = 0; x < width; x++)
-		{
-			pos = y * bytesperline + x * channels; // Calcula a posição do pixel na array de dados
-			data[pos] = 255 - data[pos]; // Inverte o pixel subtraindo seu valor de 255
-		}
+		datadst[i] = th[datasrc[0]] & ts[datasrc[1]] & tv[datasrc[2]];
 	}
+}
+
+// Ativa 'bit' nas entradas [min, max] da tabela (nenhuma se min > max)
+static void vc_hsv_table_range(unsigned char table[256], int min, int max, unsigned char bit)
+{
+	int i;
+
+	for (i = min; i <= max; i++) table[i] |= bit;
+}
 
-	return 1; // Retorna 1 após a imagem ser invertida com sucesso
+/**
+ * @brief Gera uma função de segmentação HSV para uma escala de Hue fixa (HMAX).
+ * Os limites de Hue são limitados à escala; Saturation e Value estão sempre em [0,255].
+ * HUE_CHECK é VC_HSV_HUE_CHECK(HMAX) quando HMAX < 255 e VC_HSV_HUE_NOCHECK(HMAX) quando a escala
+ * ocupa todo o unsigned char (a comparação seria sempre falsa).
+ * @author lugon
+ */
+#define VC_HSV_HUE_CHECK(HMAX) \
+	if (minHue > (HMAX)) return 0; \
+	if (maxHue > (HMAX)) maxHue = (HMAX);
+#define VC_HSV_HUE_NOCHECK(HMAX)
+
+#define VC_HSV_SEGMENTATION_IMPL(name, HMAX, HUE_CHECK) \
+int name(IVC* src, IVC* dst, unsigned char minHue, unsigned char maxHue, unsigned char minSaturation, unsigned char maxSaturation, unsigned char minValue, unsigned char maxValue) \
+{ \
+	unsigned char th[256] = { 0 }, ts[256] = { 0 }, tv[256] = { 0 }; \
+ \
+	/* Verificação de erros */ \
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL) || (dst->data == NULL)) return 0; \
+	if ((src->width != dst->width) || (src->height != dst->height)) return 0; \
+	if ((src->channels != 3) || (dst->channels != 1)) return 0; \
+	HUE_CHECK(HMAX) \
+ \
+	/* Um único intervalo, sem volta pelo 0: a máscara é diretamente 255 ou 0 */ \
+	vc_hsv_table_range(th, minHue, maxHue, 255); \
+	vc_hsv_table_range(ts, minSaturation, maxSaturation, 255); \
+	vc_hsv_table_range(tv, minValue, maxValue, 255); \
+ \
+	vc_hsv_mask_run(src->data, dst->data, (long int)src->width * src->height, th, ts, tv); \
+ \
+	return 1; \
 }
 
 /**
  * @brief Segmenta uma imagem HSV com base em intervalos de Hue, Saturation e Value.
  * @author lugon
- * @param src ponteiro para a estrutura IVC que representa a imagem de entrada em HSV.
+ * @param src ponteiro para a estrutura IVC que representa a imagem de entrada em HSV (Hue em [0,255]).
  * @param dst ponteiro para a estrutura IVC que representa a imagem de saída binarizada.
  * @param minHue valor mínimo de Hue.
  * @param maxHue valor máximo de Hue.
@@ -455,36 +537,15 @@ int vc_gray_negative(IVC* srcdst)
  * @param maxValue valor máximo de Value.
  * @return int Retorna 1 se a segmentação foi bem-sucedida, 0 caso contrário.
  */
-int vc_hsv_segmentation(IVC* src, IVC* dst, unsigned char minHue, unsigned char maxHue, unsigned char minSaturation, unsigned char maxSaturation, unsigned char minValue, unsigned char maxValue)
-{
-	unsigned char* datadst = (unsigned char*)dst->data;
-	int i, size;
-	unsigned char h, s, v;
-	int width = src->width;
-	int height = src->height;
-	int bytesperline = src->bytesperline;
-	int channels = src->channels;
-
-	size = width * height * channels;
-
-	for (i = 0; i < size; i = i + channels)
-	{
-		h = src->data[i];
-		s = src->data[i + 1];
-		v = src->data[i + 2];
-
-		if (h >= minHue && h <= maxHue && s >= minSaturation && s <= maxSaturation && v >= minValue && v <= maxValue)
-		{
-			datadst[i / channels] = 255;
-		}
-		else
-		{
-			datadst[i / channels] = 0;
-		}
-	}
+VC_HSV_SEGMENTATION_IMPL(vc_hsv_segmentation, VC_HUE_SCALE_VC, VC_HSV_HUE_NOCHECK)
 
-	return 1;
-}
+/**
+ * @brief Segmenta uma imagem HSV com Hue na escala do OpenCV ([0,180]).
+ * Os limites seguem a mesma escala, pelo que os intervalos afinados para o OpenCV podem ser usados diretamente.
+ * @author lugon
+ * @see vc_hsv_segmentation
+ */
+VC_HSV_SEGMENTATION_IMPL(vc_hsv_segmentation_180, VC_HUE_SCALE_OPENCV, VC_HSV_HUE_CHECK)
 
 /**
  * @brief Inverte os valores dos pixels de uma imagem RGB para produzir o negativo da imagem.
@@ -522,6 +583,38 @@ int vc_rgb_negative(IVC* srcdst)
 	return 1;
 }
 
+/**
+ * @brief Gera uma função que copia a componente COMP para os restantes canais (OTHER1 e OTHER2).
+ * Os índices dependem da ordem dos canais da imagem (VC_RGB_* ou VC_BGR_*).
+ * @author lugon
+ */
+#define VC_GET_GRAY_IMPL(name, COMP, OTHER1, OTHER2) \
+int name(IVC* srcdst) \
+{ \
+	unsigned char* data = (unsigned char*)srcdst->data; \
+	int width = srcdst->width; \
+	int height = srcdst->height; \
+	int bytesperline = srcdst->width * srcdst->channels; \
+	int channels = srcdst->channels; \
+	int x, y; \
+	long int pos; \
+ \
+	/* Verificação de erros */ \
+	if ((srcdst->width <= 0) || (srcdst->height <= 0) || (srcdst->data == NULL)) return 0; \
+	if (channels != 3) return 0; \
+ \
+	for (y = 0; y < height; y++) \
+	{ \
+		for (x = 0; x < width; x++) \
+		{ \
+			pos = y * bytesperline + x * channels; \
+			data[pos + (OTHER1)] = data[pos + (COMP)]; \
+			data[pos + (OTHER2)] = data[pos + (COMP)]; \
+		} \
+	} \
+	return 1; \
+}
+
 /**
  * @brief Converte a componente vermelha (Red) de uma imagem RGB para escala de cinza.
  * @author lugon
@@ -529,32 +622,7 @@ int vc_rgb_negative(IVC* srcdst)
  * Esta estrutura deve ser pré-alocada e conter dados válidos de imagem.
  * @return int Retorna 1 se a conversão foi bem-sucedida, 0 se houve um erro, como dimensões inválidas ou formato de cor incorreto.
  */
-int vc_rgb_get_red_gray(IVC* srcdst)
-{
-	unsigned char* data = (unsigned char*)srcdst->data;
-	int width = srcdst->width;
-	int height = srcdst->height;
-	int bytesperline = srcdst->width * srcdst->channels;
-	int channels = srcdst->channels;
-	int x, y;
-	long int pos;
-
-	//verificaçao de erros
-	if ((srcdst->width <= 0) || (srcdst->height <= 0) || (srcdst->data == NULL)) return 0;
-	if (channels != 3) return 0;
-
-	//Extrai a componente Red
-	for (y = 0; y < height; y++)
-	{
-		for (x = 0; x < width; x++)
-		{
-			pos = y * bytesperline + x * channels;
-			data[pos + 1] = data[pos]; //green
-			data[pos + 2] = data[pos]; //blue
-		}
-	}
-	return 1;
-}
+VC_GET_GRAY_IMPL(vc_rgb_get_red_gray, VC_RGB_R, VC_RGB_G, VC_RGB_B)
 
 /**
  * @brief Converte a componente verde (Green) de uma imagem RGB para escala de cinza.
@@ -563,33 +631,7 @@ int vc_rgb_get_red_gray(IVC* srcdst)
  * Esta estrutura deve ser pré-alocada e conter dados válidos de imagem.
  * @return int Retorna 1 se a conversão foi bem-sucedida, 0 se houve um erro, como dimensões inválidas ou formato de cor incorreto.
  */
-int vc_rgb_get_green_gray(IVC* srcdst)
-{
-	unsigned char* data = (unsigned char*)srcdst->data;
-	int width = srcdst->width;
-	int height = srcdst->height;
-	int bytesperline = srcdst->width * srcdst->channels;
-	int channels = srcdst->channels;
-	int x, y;
-	long int pos;
-
-	//verificaçao de erros
-	if ((srcdst->width <= 0) || (srcdst->height <= 0) || (srcdst->data == NULL)) return 0;
-	if (channels != 3) return 0;
-
-	//Extrai a componente Green
-	for (y = 0; y < height; y++)
-	{
-		for (x = 0; x < width; x++)
-		{
-			pos = y * bytesperline + x * channels;
-			data[pos] = data[pos + 1]; //red
-			data[pos + 2] = data[pos + 1]; //blue
-		}
-	}
-
-	return 1;
-}
+VC_GET_GRAY_IMPL(vc_rgb_get_green_gray, VC_RGB_G, VC_RGB_R, VC_RGB_B)
 
 /**
  * @brief Converte a componente azul (Blue) de uma imagem RGB para escala de cinza.
@@ -598,165 +640,229 @@ int vc_rgb_get_green_gray(IVC* srcdst)
  * Esta estrutura deve ser pré-alocada e conter dados válidos de imagem.
  * @return int Retorna 1 se a conversão foi bem-sucedida, 0 se houve um erro, como dimensões inválidas ou formato de cor incorreto.
  */
-int vc_rgb_get_blue_gray(IVC* srcdst)
+VC_GET_GRAY_IMPL(vc_rgb_get_blue_gray, VC_RGB_B, VC_RGB_R, VC_RGB_G)
+
+/**
+ * @brief Equivalentes de vc_rgb_get_*_gray para imagens BGR (ordem do OpenCV).
+ * @author lugon
+ */
+VC_GET_GRAY_IMPL(vc_bgr_get_red_gray, VC_BGR_R, VC_BGR_G, VC_BGR_B)
+VC_GET_GRAY_IMPL(vc_bgr_get_green_gray, VC_BGR_G, VC_BGR_R, VC_BGR_B)
+VC_GET_GRAY_IMPL(vc_bgr_get_blue_gray, VC_BGR_B, VC_BGR_R, VC_BGR_G)
+
+// Pesos da luminância em vírgula fixa Q7 (0.299, 0.587 e 0.114 multiplicados por 128).
+// Cabem num byte com sinal, como exige o pmaddubsw, e a soma máxima (128 * 255) cabe em 16 bits.
+// O resultado é truncado (>> 7), tal como a conversão (unsigned char) da versão em vírgula flutuante;
+// a diferença para essa referência é no máximo de 1 nível (verificado nas 2^24 combinações RGB).
+#define VC_GRAY_WR 38
+#define VC_GRAY_WG 75
+#define VC_GRAY_WB 15
+#define VC_GRAY_SHIFT 7
+
+// Peso Q7 do canal ch, dados os índices dos canais R, G e B
+#define VC_GRAY_CH_WEIGHT(ch, R, G, B) ((ch) == (R) ? VC_GRAY_WR : ((ch) == (G) ? VC_GRAY_WG : VC_GRAY_WB))
+
+/**
+ * @brief Converte npixels pixels de 3 canais consecutivos para escala de cinza em vírgula fixa.
+ * @author lugon
+ * @param src Dados de origem (3 bytes por pixel).
+ * @param dst Dados de destino (1 byte por pixel).
+ * @param npixels Número de pixels a converter.
+ * @param w0 Peso Q7 do canal 0.
+ * @param w1 Peso Q7 do canal 1.
+ * @param w2 Peso Q7 do canal 2.
+ */
+static void vc_gray_fixed_run(const unsigned char* src, unsigned char* dst, long int npixels, int w0, int w1, int w2)
 {
-	unsigned char* data = (unsigned char*)srcdst->data;
-	int width = srcdst->width;
-	int height = srcdst->height;
-	int bytesperline = srcdst->width * srcdst->channels;
-	int channels = srcdst->channels;
-	int x, y;
-	long int pos;
+	long int i = 0;
 
-	//verificaçao de erros
-	if ((srcdst->width <= 0) || (srcdst->height <= 0) || (srcdst->data == NULL)) return 0;
-	if (channels != 3) return 0;
+#ifdef VC_SSSE3
+	// 16 pixels (48 bytes) por iteração: cada registo recebe 4 pixels no formato [c0 c1 c2 0],
+	// o pmaddubsw produz (w0*c0 + w1*c1, w2*c2) e o phaddw soma os dois termos de cada pixel
+	const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m128i weights = _mm_setr_epi8((char)w0, (char)w1, (char)w2, 0, (char)w0, (char)w1, (char)w2, 0,
+		(char)w0, (char)w1, (char)w2, 0, (char)w0, (char)w1, (char)w2, 0);
 
-	//Extrai a componente Blue
-	for (y = 0; y < height; y++)
+	for (; i + 16 <= npixels; i += 16, src += 48)
 	{
-		for (x = 0; x < width; x++)
-		{
-			pos = y * bytesperline + x * channels;
-			data[pos] = data[pos + 2]; //red
-			data[pos + 1] = data[pos + 2]; //green
-		}
+		__m128i v0 = _mm_loadu_si128((const __m128i*)(src));
+		__m128i v1 = _mm_loadu_si128((const __m128i*)(src + 16));
+		__m128i v2 = _mm_loadu_si128((const __m128i*)(src + 32));
+
+		__m128i p0 = _mm_shuffle_epi8(v0, shuffle);							// pixels 0..3   (bytes 0..11)
+		__m128i p1 = _mm_shuffle_epi8(_mm_alignr_epi8(v1, v0, 12), shuffle);	// pixels 4..7   (bytes 12..23)
+		__m128i p2 = _mm_shuffle_epi8(_mm_alignr_epi8(v2, v1, 8), shuffle);	// pixels 8..11  (bytes 24..35)
+		__m128i p3 = _mm_shuffle_epi8(_mm_srli_si128(v2, 4), shuffle);		// pixels 12..15 (bytes 36..47)
+
+		__m128i lo = _mm_hadd_epi16(_mm_maddubs_epi16(p0, weights), _mm_maddubs_epi16(p1, weights));
+		__m128i hi = _mm_hadd_epi16(_mm_maddubs_epi16(p2, weights), _mm_maddubs_epi16(p3, weights));
+
+		lo = _mm_srli_epi16(lo, VC_GRAY_SHIFT);
+		hi = _mm_srli_epi16(hi, VC_GRAY_SHIFT);
+
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+	}
+#endif
+
+	for (; i < npixels; i++, src += 3)
+	{
+		dst[i] = (unsigned char)((w0 * src[0] + w1 * src[1] + w2 * src[2]) >> VC_GRAY_SHIFT);
 	}
+}
 
-	return 1;
+/**
+ * @brief Gera uma função de conversão para escala de cinza para a ordem de canais (R, G, B).
+ * Os pesos de cada canal são resolvidos em tempo de compilação.
+ * @author lugon
+ */
+#define VC_TO_GRAY_IMPL(name, R, G, B) \
+int name(IVC* src, IVC* dst) \
+{ \
+	/* Verificação de erros */ \
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL) || (dst->data == NULL)) return 0; \
+	if ((src->width != dst->width) || (src->height != dst->height)) return 0; \
+	if ((src->channels != 3) || (dst->channels != 1)) return 0; \
+ \
+	/* As linhas são contíguas (bytesperline = width * channels): a imagem é convertida numa só passagem */ \
+	vc_gray_fixed_run(src->data, dst->data, (long int)src->width * src->height, \
+		VC_GRAY_CH_WEIGHT(0, R, G, B), VC_GRAY_CH_WEIGHT(1, R, G, B), VC_GRAY_CH_WEIGHT(2, R, G, B)); \
+ \
+	return 1; \
 }
 
 /**
- * @brief Converte uma imagem RGB para escala de cinza.
+ * @brief Converte uma imagem RGB para escala de cinza (luminância em vírgula fixa Q7, vetorizada com SSSE3).
  * @author lugon
  * @param src Ponteiro para a estrutura IVC que representa a imagem RGB de entrada.
  * @param dst Ponteiro para a estrutura IVC que representa a imagem de saída em escala de cinza.
  * Esta estrutura deve ser pré-alocada e conter dados válidos de imagem.
  * @return int Retorna 1 se a conversão foi bem-sucedida, 0 se houve um erro, como dimensões inválidas ou formato de cor incorreto.
  */
-int vc_rgb_to_gray(IVC* src, IVC* dst)
-{
-	unsigned char* datasrc = (unsigned char*)src->data;
-	int bytesperline_src = src->width * src->channels;
-	int channels_src = src->channels;
-	unsigned char* datadst = (unsigned char*)dst->data;
-	int bytesperline_dst = dst->width * dst->channels;
-	int channels_dst = dst->channels;
-	int width = src->width;
-	int height = src->height;
-	int x, y;
-	long int pos_src, pos_dst;
-	float rf, gf, bf;
-
-	//verificação de erros
-	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
-	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
-	if ((src->channels != 3) || (dst->channels != 1)) return 0;
-
-	for (y = 0; y < height; y++)
-	{
-		for (x = 0; x < width; x++)
-		{
-			pos_src = y * bytesperline_src + x * channels_src;
-			pos_dst = y * bytesperline_dst + x * channels_dst;
+VC_TO_GRAY_IMPL(vc_rgb_to_gray, VC_RGB_R, VC_RGB_G, VC_RGB_B)
 
-			rf = (float)datasrc[pos_src];
-			gf = (float)datasrc[pos_src + 1];
-			bf = (float)datasrc[pos_src + 2];
+/**
+ * @brief Converte uma imagem BGR (ordem do OpenCV) para escala de cinza.
+ * @author lugon
+ * @see vc_rgb_to_gray
+ */
+VC_TO_GRAY_IMPL(vc_bgr_to_gray, VC_BGR_R, VC_BGR_G, VC_BGR_B)
 
-			datadst[pos_dst] = (unsigned char)((rf * 0.299) + (gf * 0.587) + (bf * 0.114));
-		}
-	}
-	return 1;
+/**
+ * @brief Gera uma função de conversão para HSV para a ordem de canais (R, G, B) e escala de Hue HMAX.
+ * @author lugon
+ */
+#define VC_TO_HSV_IMPL(name, R, G, B, HMAX) \
+int name(IVC* src, IVC* dst) \
+{ \
+	unsigned char* data_src = (unsigned char*)src->data; \
+	unsigned char* data_dst = (unsigned char*)dst->data; \
+	int width = src->width; \
+	int height = src->height; \
+	int channels = src->channels; \
+	float r, g, b, hue, saturation, value; \
+	float rgb_max, rgb_min; \
+	int i, size; \
+ \
+	/* Verificação de erros */ \
+	if ((width <= 0) || (height <= 0) || (data_src == NULL) || (data_dst == NULL)) \
+		return 0; \
+	if (channels != 3 || dst->channels != 3) \
+		return 0; \
+ \
+	size = width * height * channels; \
+ \
+	for (i = 0; i < size; i = i + channels) \
+	{ \
+		r = (float)data_src[i + (R)]; \
+		g = (float)data_src[i + (G)]; \
+		b = (float)data_src[i + (B)]; \
+ \
+		/* Calcula valores máximo e mínimo dos canais de cor R, G e B */ \
+		rgb_max = (r > g ? (r > b ? r : b) : (g > b ? g : b)); \
+		rgb_min = (r < g ? (r < b ? r : b) : (g < b ? g : b)); \
+ \
+		/* Value toma valores entre [0,255] */ \
+		value = rgb_max; \
+		if (value == 0.0f) \
+		{ \
+			hue = 0.0f; \
+			saturation = 0.0f; \
+		} \
+		else \
+		{ \
+			/* Saturation toma valores entre [0,255] */ \
+			saturation = ((rgb_max - rgb_min) / rgb_max) * 255.0f; \
+ \
+			if (saturation == 0.0f) \
+			{ \
+				hue = 0.0f; \
+			} \
+			else \
+			{ \
+				/* Hue toma valores entre [0,360] */ \
+				if ((rgb_max == r) && (g >= b)) \
+				{ \
+					hue = 60.0f * (g - b) / (rgb_max - rgb_min); \
+				} \
+				else if ((rgb_max == r) && (b > g)) \
+				{ \
+					hue = 360.0f + 60.0f * (g - b) / (rgb_max - rgb_min); \
+				} \
+				else if (rgb_max == g) \
+				{ \
+					hue = 120.0f + 60.0f * (b - r) / (rgb_max - rgb_min); \
+				} \
+				else /* rgb_max == b */ \
+				{ \
+					hue = 240.0f + 60.0f * (r - g) / (rgb_max - rgb_min); \
+				} \
+			} \
+		} \
+ \
+		/* Atribui Hue em [0,HMAX] e Saturation/Value em [0,255] no destino */ \
+		data_dst[i] = (unsigned char)(hue / 360.0f * (float)(HMAX)); \
+		data_dst[i + 1] = (unsigned char)(saturation); \
+		data_dst[i + 2] = (unsigned char)(value); \
+	} \
+ \
+	return 1; \
 }
 
 /**
  * @brief Converte uma imagem RGB para HSV.
  * @author lugon
  * @param src Ponteiro para a estrutura IVC que representa a imagem RGB de entrada.
- * @param dst Ponteiro para a estrutura IVC que representa a imagem de saída em HSV.
+ * @param dst Ponteiro para a estrutura IVC que representa a imagem de saída em HSV (Hue em [0,255]).
  * Esta estrutura deve ser pré-alocada e conter dados válidos de imagem.
  * @return int Retorna 1 se a conversão foi bem-sucedida, 0 se houve um erro, como dimensões inválidas ou formato de cor incorreto.
  */
-int vc_rgb_to_hsv(IVC* src, IVC* dst)
-{
-	unsigned char* data_src = (unsigned char*)src->data;
-	unsigned char* data_dst = (unsigned char*)dst->data;
-	int width = src->width;
-	int height = src->height;
-	int bytesperline = src->bytesperline;
-	int channels = src->channels;
-	float r, g, b, hue, saturation, value;
-	float rgb_max, rgb_min;
-	int i, size;
-
-	// Verificação de erros
-	if ((width <= 0) || (height <= 0) || (data_src == NULL) || (data_dst == NULL))
-		return 0;
-	if (channels != 3 || dst->channels != 3)
-		return 0;
-
-	size = width * height * channels;
-
-	for (i = 0; i < size; i = i + channels)
-	{
-		r = (float)data_src[i];
-		g = (float)data_src[i + 1];
-		b = (float)data_src[i + 2];
+VC_TO_HSV_IMPL(vc_rgb_to_hsv, VC_RGB_R, VC_RGB_G, VC_RGB_B, VC_HUE_SCALE_VC)
 
-		// Calcula valores máximo e mínimo dos canais de cor R, G e B
-		rgb_max = (r > g ? (r > b ? r : b) : (g > b ? g : b));
-		rgb_min = (r < g ? (r < b ? r : b) : (g < b ? g : b));
-
-		// Value toma valores entre [0,255]
-		value = rgb_max;
-		if (value == 0.0f)
-		{
-			hue = 0.0f;
-			saturation = 0.0f;
-		}
-		else
-		{
-			// Saturation toma valores entre [0,255]
-			saturation = ((rgb_max - rgb_min) / rgb_max) * 255.0f;
-
-			if (saturation == 0.0f)
-			{
-				hue = 0.0f;
-			}
-			else
-			{
-				// Hue toma valores entre [0,360]
-				if ((rgb_max == r) && (g >= b))
-				{
-					hue = 60.0f * (g - b) / (rgb_max - rgb_min);
-				}
-				else if ((rgb_max == r) && (b > g))
-				{
-					hue = 360.0f + 60.0f * (g - b) / (rgb_max - rgb_min);
-				}
-				else if (rgb_max == g)
-				{
-					hue = 120.0f + 60.0f * (b - r) / (rgb_max - rgb_min);
-				}
-				else /* rgb_max == b*/
-				{
-					hue = 240.0f + 60.0f * (r - g) / (rgb_max - rgb_min);
-				}
-			}
-		}
+/**
+ * @brief Converte uma imagem BGR (ordem do OpenCV) para HSV, com Hue em [0,255].
+ * @author lugon
+ * @see vc_rgb_to_hsv
+ */
+VC_TO_HSV_IMPL(vc_bgr_to_hsv, VC_BGR_R, VC_BGR_G, VC_BGR_B, VC_HUE_SCALE_VC)
 
-		// Atribui valores entre [0,255] no destino
-		data_dst[i] = (unsigned char)(hue / 360.0f * 255.0f);
-		data_dst[i + 1] = (unsigned char)(saturation);
-		data_dst[i + 2] = (unsigned char)(value);
-	}
+/**
+ * @brief Converte uma imagem RGB para HSV, com Hue na escala do OpenCV ([0,180]).
+ * @author lugon
+ * @see vc_rgb_to_hsv
+ */
+VC_TO_HSV_IMPL(vc_rgb_to_hsv_180, VC_RGB_R, VC_RGB_G, VC_RGB_B, VC_HUE_SCALE_OPENCV)
 
-	return 1;
-}
+/**
+ * @brief Converte uma imagem BGR para HSV, com Hue na escala do OpenCV ([0,180]).
+ * Lê diretamente as frames do OpenCV e produz Hue na escala dos intervalos afinados para o OpenCV.
+ * @author lugon
+ * @see vc_rgb_to_hsv
+ */
+VC_TO_HSV_IMPL(vc_bgr_to_hsv_180, VC_BGR_R, VC_BGR_G, VC_BGR_B, VC_HUE_SCALE_OPENCV)
 
 /**
  * @brief Converte uma imagem em escala de cinza para uma imagem RGB com coloração baseada em níveis de intensidade.
+ * Equivale a aplicar a paleta VC_COLORMAP_HEAT com vc_gray_to_colormap().
  * @author lugon
  * @param src Ponteiro para a estrutura IVC que representa a imagem em escala de cinza.
  * @param dst Ponteiro para a estrutura IVC que representa a imagem RGB de saída.
@@ -765,382 +871,336 @@ int vc_rgb_to_hsv(IVC* src, IVC* dst)
  */
 int vc_scale_gray_to_rgb(IVC* src, IVC* dst)
 {
-	// info source
-	unsigned char* datasrc = (unsigned char*)src->data;
-	int bytesperline_src = src->width * src->channels;
-	int channels_src = src->channels;
-
-	//info destino
-	unsigned char* datadst = (unsigned char*)dst->data;
-	int bytesperline_dst = dst->width * dst->channels;
-	int channels_dst = dst->channels;
+	PVC palette;
 
-	// medidas
-	int width = src->width;
-	int height = src->height;
+	vc_palette_builtin(&palette, VC_COLORMAP_HEAT);
 
-	//auxiliares gerais
-	int x, y;
-	long int pos_src, pos_dst;
-	float gray;
+	return vc_gray_to_colormap(src, dst, &palette);
+}
 
-	//verificação de erros
-	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
-	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
-	if ((src->channels != 1) || (dst->channels != 3)) return 0;
+/**
+ * @brief Preenche uma entrada da paleta.
+ * @author lugon
+ */
+static void vc_palette_set(PVC* palette, int i, int r, int g, int b, int a)
+{
+	palette->color[i][0] = (unsigned char)r;
+	palette->color[i][1] = (unsigned char)g;
+	palette->color[i][2] = (unsigned char)b;
+	palette->color[i][3] = (unsigned char)a;
+}
 
-	for (y = 0;y < height;y++)
-	{
-		for (x = 0;x < width; x++)
-		{
-			pos_src = y * bytesperline_src + x * channels_src;//posicao da source
-			pos_dst = y * bytesperline_dst + x * channels_dst;//posicao destino
+/**
+ * @brief Componente da paleta Jet: 1.5 - |4x - c|, limitada a [0,1] e escalada para [0,255].
+ * @author lugon
+ */
+static int vc_palette_jet_component(int i, float c)
+{
+	float v = 1.5f - fabsf(4.0f * i / 255.0f - c);
 
-			gray = (float)datasrc[pos_src];
+	if (v < 0.0f) v = 0.0f;
+	if (v > 1.0f) v = 1.0f;
 
-			if (gray < 64)
-			{
-				datadst[pos_dst] = (unsigned char)0;
-				datadst[pos_dst + 1] = (unsigned char)(gray * 4);
-				datadst[pos_dst + 2] = (unsigned char)255;
-			}
-			else if (gray < 128)
-			{
-				datadst[pos_dst] = (unsigned char)0;
-				datadst[pos_dst + 1] = (unsigned char)255;
-				datadst[pos_dst + 2] = (unsigned char)(255 - (gray - 64) * 4);
-			}
-			else if (gray < 192)
-			{
-				datadst[pos_dst] = (unsigned char)((gray - 128) * 4);
-				datadst[pos_dst + 1] = (unsigned char)255;
-				datadst[pos_dst + 2] = (unsigned char)0;
-			}
-			else if (gray <= 255)
-			{
-				datadst[pos_dst] = (unsigned char)255;
-				datadst[pos_dst + 1] = (unsigned char)(255 - (gray - 192) * 4);
-				datadst[pos_dst + 2] = (unsigned char)0;
-			}
-		}
-	}
-	return 1;
+	return (int)(v * 255.0f + 0.5f);
 }
 
 /**
- * @brief Converte uma imagem em escala de cinza para binária usando um valor de threshold.
+ * @brief Preenche uma paleta predefinida.
  * @author lugon
- * @param src Ponteiro para a estrutura IVC que representa a imagem em escala de cinza de entrada.
- * @param dst Ponteiro para a estrutura IVC que representa a imagem binária de saída.
- * @param threshold Valor de threshold usado para a conversão.
- * @return int Retorna 1 se a conversão foi bem-sucedida, 0 se houve um erro, como dimensões inválidas ou formato de cor incorreto.
+ * @param palette Paleta a preencher (em ordem RGB).
+ * @param colormap VC_COLORMAP_HEAT, VC_COLORMAP_JET ou VC_COLORMAP_LABEL.
+ * @return int Retorna 1 se a paleta foi preenchida, 0 se o colormap é desconhecido.
  */
-int vc_gray_to_binary(IVC* src, IVC* dst, int threshold)
+int vc_palette_builtin(PVC* palette, int colormap)
 {
-	unsigned char* src_data = (unsigned char*)src->data;
-	unsigned char* dst_data = (unsigned char*)dst->data;
-	int width = src->width;
-	int height = src->height;
-	int src_bytesperline = src->bytesperline;
-	int dst_bytesperline = dst->bytesperline;
-	int src_channels = src->channels;
-	int dst_channels = dst->channels;
-	int x, y;
-	long int src_pos, dst_pos;
+	int i, h, sector, f, q, t;
+	const int v = 255, p = 38;	// Value e mínimo (Saturation = 85%) das cores das etiquetas
 
-	// Verificação de erros
-	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
-	if (src_channels != 1 || dst_channels != 1) return 0;
+	if (palette == NULL) return 0;
 
-	// Converter imagem Gray para Binária
-	for (y = 0; y < height; y++)
+	switch (colormap)
 	{
-		for (x = 0; x < width; x++)
+	case VC_COLORMAP_HEAT:
+		for (i = 0; i < 256; i++)
 		{
-			src_pos = y * src_bytesperline + x * src_channels;
-			dst_pos = y * dst_bytesperline + x * dst_channels;
-
-			if (src_data[src_pos] < threshold) dst_data[dst_pos] = 0;
-			else dst_data[dst_pos] = 255;
+			if (i < 64) vc_palette_set(palette, i, 0, i * 4, 255, 255);
+			else if (i < 128) vc_palette_set(palette, i, 0, 255, 255 - (i - 64) * 4, 255);
+			else if (i < 192) vc_palette_set(palette, i, (i - 128) * 4, 255, 0, 255);
+			else vc_palette_set(palette, i, 255, 255 - (i - 192) * 4, 0, 255);
 		}
-	}
+		return 1;
 
-	// Definir o número de níveis da imagem de destino para 2 (binária)
-	dst->levels = 2;
+	case VC_COLORMAP_JET:
+		for (i = 0; i < 256; i++)
+		{
+			vc_palette_set(palette, i, vc_palette_jet_component(i, 3.0f), vc_palette_jet_component(i, 2.0f), vc_palette_jet_component(i, 1.0f), 255);
+		}
+		return 1;
 
-	return 1;
+	case VC_COLORMAP_LABEL:
+		// Etiqueta 0 (fundo) preta e transparente; as restantes percorrem o Hue pela razão de ouro,
+		// para que etiquetas consecutivas tenham cores bem distintas
+		vc_palette_set(palette, 0, 0, 0, 0, 0);
+		for (i = 1; i < 256; i++)
+		{
+			h = (i * 2654435769u) >> 22;	// Hue em [0,1024)
+			sector = h / 171;				// 6 setores de ~60º
+			f = (h % 171) * 255 / 170;
+			q = v - (v - p) * f / 255;
+			t = p + (v - p) * f / 255;
+
+			switch (sector)
+			{
+			case 0: vc_palette_set(palette, i, v, t, p, 255); break;
+			case 1: vc_palette_set(palette, i, q, v, p, 255); break;
+			case 2: vc_palette_set(palette, i, p, v, t, 255); break;
+			case 3: vc_palette_set(palette, i, p, q, v, 255); break;
+			case 4: vc_palette_set(palette, i, t, p, v, 255); break;
+			default: vc_palette_set(palette, i, v, p, q, 255); break;
+			}
+		}
+		return 1;
+	}
+
+	return 0;
 }
 
 /**
- * @brief Obtém o negativo de uma imagem binarizada.
+ * @brief Troca a ordem dos canais da paleta (RGB <-> BGR), para aplicar a paleta diretamente a frames do OpenCV.
  * @author lugon
- * @param image Ponteiro para a estrutura IVC que representa a imagem binarizada.
- * Esta estrutura deve ser pré-alocada e conter dados válidos de imagem.
+ * @param palette Paleta a converter.
  */
-void vc_binary_get_negative(IVC* image)
+void vc_palette_to_bgr(PVC* palette)
 {
-	// Obtém as informações da imagem binarizada
-	unsigned char* data = (unsigned char*)image->data;
-	int bytesperline = image->bytesperline;
-	int channels = image->channels;
-	int width = image->width;
-	int height = image->height;
-	long int pos;
+	int i;
+	unsigned char tmp;
 
-	// Aplica o negativo invertendo os valores dos pixels
-	for (int y = 0; y < height; y++)
+	for (i = 0; i < 256; i++)
 	{
-		for (int x = 0; x < width; x++)
-		{
-			pos = y * bytesperline + x * channels;
-			if (data[pos] == 0)
-			{
-				data[pos] = 255; // Troca pixel preto por branco
-			}
-			else
-			{
-				data[pos] = 0; // Troca pixel branco por preto
-			}
-		}
+		tmp = palette->color[i][0];
+		palette->color[i][0] = palette->color[i][2];
+		palette->color[i][2] = tmp;
 	}
 }
 
 /**
- * @brief Converte uma imagem em escala de cinza para binária usando a média global como valor de threshold.
+ * @brief Aplica uma paleta a uma imagem em escala de cinza (pseudo-cor), com uma consulta à tabela por pixel.
+ * Com AVX2 as consultas são feitas 8 a 8 com vpgatherdd.
  * @author lugon
- * @param src Ponteiro para a estrutura IVC que representa a imagem em escala de cinza de entrada.
- * @param dst Ponteiro para a estrutura IVC que representa a imagem binária de saída.
+ * @param src Imagem de origem em escala de cinza (ou imagem de etiquetas).
+ * @param dst Imagem de destino com 3 canais, na ordem da paleta.
+ * @param palette Paleta a aplicar.
  * @return int Retorna 1 se a conversão foi bem-sucedida, 0 se houve um erro, como dimensões inválidas ou formato de cor incorreto.
  */
-int vc_gray_to_binary_global_mean(IVC* src, IVC* dst)
+int vc_gray_to_colormap(IVC* src, IVC* dst, PVC* palette)
 {
-	// Informações da imagem de origem
 	unsigned char* datasrc = (unsigned char*)src->data;
-	int bytesperline_src = src->width * src->channels;
-	int channels_src = src->channels;
-
-	// Informações da imagem de destino
 	unsigned char* datadst = (unsigned char*)dst->data;
-	int bytesperline_dst = dst->width * dst->channels;
-	int channels_dst = dst->channels;
+	long int i = 0, npixels;
+	const unsigned char* c;
 
-	// Medidas
-	int width = src->width;
-	int height = src->height;
-
-	// Auxiliares
-	long int soma = 0;
-	float media;
-	int x, y, pos_src, pos_dst;
-
-	// Verificações de erros
-	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL) || (dst->data == NULL) || (palette == NULL)) return 0;
 	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
-	if ((src->channels != 1) || (dst->channels != 1)) return 0;
+	if ((src->channels != 1) || (dst->channels != 3)) return 0;
 
-	// Calcula a média global
-	for (y = 0; y < height; y++)
+	npixels = (long int)src->width * src->height;
+
+#ifdef VC_AVX2
 	{
-		for (x = 0; x < width; x++)
+		// Compacta cada grupo de 4 entradas (R,G,B,A) em 12 bytes (R,G,B), em cada metade de 128 bits
+		const __m256i pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+			0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+		const int* table = (const int*)palette->color;
+		unsigned char* d = datadst;
+
+		// Cada escrita de 16 bytes só tem 12 válidos: os 4 restantes são reescritos na iteração seguinte,
+		// pelo que se garante que existem sempre pelo menos mais 2 pixels depois do bloco
+		for (; i + 10 <= npixels; i += 8, d += 24)
 		{
-			pos_src = y * bytesperline_src + x * channels_src;
-			soma += datasrc[pos_src];
+			__m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(datasrc + i)));
+			__m256i rgba = _mm256_i32gather_epi32(table, idx, 4);
+			__m256i rgb = _mm256_shuffle_epi8(rgba, pack);
+
+			_mm_storeu_si128((__m128i*)d, _mm256_castsi256_si128(rgb));
+			_mm_storeu_si128((__m128i*)(d + 12), _mm256_extracti128_si256(rgb, 1));
 		}
 	}
-	media = (float)soma / (height * width);
+#endif
 
-	// Aplica a binarização
-	for (y = 0; y < height; y++)
+	for (; i < npixels; i++)
 	{
-		for (x = 0; x < width; x++)
-		{
-			pos_src = y * bytesperline_src + x * channels_src;
-			pos_dst = y * bytesperline_dst + x * channels_dst;
-			if (datasrc[pos_src] < media)
-			{
-				datadst[pos_dst] = 0; // Preto
-			}
-			else
-			{
-				datadst[pos_dst] = 255; // Branco
-			}
-		}
+		c = palette->color[datasrc[i]];
+		datadst[i * 3] = c[0];
+		datadst[i * 3 + 1] = c[1];
+		datadst[i * 3 + 2] = c[2];
 	}
+
 	return 1;
 }
 
 /**
- * @brief Converte uma imagem em escala de cinza para binária usando o método Midpoint com um kernel.
+ * @brief Aplica uma paleta a uma imagem em escala de cinza e mistura o resultado com uma imagem base.
+ * A opacidade de cada pixel é A * alpha / 255, onde A é a opacidade da entrada da paleta
+ * (na paleta VC_COLORMAP_LABEL o fundo é transparente e mantém a imagem base).
  * @author lugon
- * @param src Ponteiro para a estrutura IVC que representa a imagem em escala de cinza de entrada.
- * @param dst Ponteiro para a estrutura IVC que representa a imagem binária de saída.
- * @param kernel Tamanho do kernel a ser usado para a conversão.
- * @return int Retorna 1 se a conversão foi bem-sucedida, 0 se houve um erro, como dimensões inválidas ou formato de cor incorreto.
+ * @param src Imagem de origem em escala de cinza (ou imagem de etiquetas).
+ * @param base Imagem base com 3 canais (pode ser a própria dst).
+ * @param dst Imagem de destino com 3 canais.
+ * @param palette Paleta a aplicar, na ordem dos canais da imagem base.
+ * @param alpha Opacidade global da paleta, em [0,255].
+ * @return int Retorna 1 se a mistura foi bem-sucedida, 0 se houve um erro, como dimensões inválidas ou formato de cor incorreto.
  */
-int vc_gray_to_binary_kernel_midpoint(IVC* src, IVC* dst, int kernel)
+int vc_gray_to_colormap_blend(IVC* src, IVC* base, IVC* dst, PVC* palette, int alpha)
 {
-	// info source
 	unsigned char* datasrc = (unsigned char*)src->data;
-	int bytesperline_src = src->width * src->channels;
-	int channels_src = src->channels;
-
-	//info destino
+	unsigned char* database = (unsigned char*)base->data;
 	unsigned char* datadst = (unsigned char*)dst->data;
-	int bytesperline_dst = dst->width * dst->channels;
-	int channels_dst = dst->channels;
+	long int i, npixels;
+	int a, c, t, opacity[256];
+	const unsigned char* color;
 
-	// medidas
-	int width = src->width;
-	int height = src->height;
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL) || (base->data == NULL) || (dst->data == NULL) || (palette == NULL)) return 0;
+	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
+	if ((base->width != dst->width) || (base->height != dst->height)) return 0;
+	if ((src->channels != 1) || (base->channels != 3) || (dst->channels != 3)) return 0;
+	if ((alpha < 0) || (alpha > 255)) return 0;
 
-	//auxiliares gerais
-	int x, y, x2, y2, ksize;
-	long int pos_src, pos_dst, pos_src2;
-	float treshold, min, max;
+	// Opacidade efetiva de cada nível, calculada uma vez por chamada
+	for (i = 0; i < 256; i++)
+	{
+		opacity[i] = (palette->color[i][3] * alpha + 127) / 255;
+	}
 
-	//verificação de erros
-	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
-	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
-	if ((src->channels != 1) || (dst->channels != 1)) return 0;
+	npixels = (long int)src->width * src->height;
 
-	ksize = (kernel - 1) / 2;
-	for (y = 0;y < height;y++)
+	for (i = 0; i < npixels; i++)
 	{
-		for (x = 0;x < width; x++)
-		{
-			min = 255;
-			max = 0;
-			pos_src = y * bytesperline_src + x * channels_src;//posicao da source
-			pos_dst = y * bytesperline_dst + x * channels_dst;//posicao destino
+		color = palette->color[datasrc[i]];
+		a = opacity[datasrc[i]];
 
-			for (y2 = (y - ksize); y2 <= (y + ksize);y2++)
-			{
-				for (x2 = (x - ksize); x2 <= (x + ksize);x2++)
-				{
-					if ((y2 >= 0) && (y2 < height) && (x2 >= 0) && (x2 < width))
-					{
-						pos_src2 = y2 * bytesperline_src + x2 * channels_src;//posicao da source
-						//pos_dst = y2 * bytesperline_dst + x2 * channels_dst;//posicao destino
-						if (max <= (float)datasrc[pos_src2])
-						{
-							max = (float)datasrc[pos_src2];
-						}
-						if (min >= (float)datasrc[pos_src2])
-						{
-							min = (float)datasrc[pos_src2];
-						}
-					}
-					else datadst[pos_dst] = 0;
-				}
-			}
-			treshold = (min + max) * (0.5);//mid point 
-			if ((float)datasrc[pos_src] < treshold) datadst[pos_dst] = 0;
-			else datadst[pos_dst] = 1;
+		// (a * cor + (255 - a) * base) / 255, arredondado, com a divisão por 255 feita por deslocamentos
+		for (c = 0; c < 3; c++)
+		{
+			t = a * color[c] + (255 - a) * database[i * 3 + c] + 128;
+			datadst[i * 3 + c] = (unsigned char)((t + (t >> 8)) >> 8);
 		}
 	}
+
+	return 1;
+}
+
+/**
+ * @brief Converte uma imagem em escala de cinza para binária usando um valor de threshold.
+ * @author lugon
+ * @param src Ponteiro para a estrutura IVC que representa a imagem em escala de cinza de entrada.
+ * @param dst Ponteiro para a estrutura IVC que representa a imagem binária de saída.
+ * @param threshold Valor de threshold usado para a conversão.
+ * @return int Retorna 1 se a conversão foi bem-sucedida, 0 se houve um erro, como dimensões inválidas ou formato de cor incorreto.
+ */
+int vc_gray_to_binary(IVC* src, IVC* dst, int threshold)
+{
+	LVC lut;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
+	if (src->channels != 1 || dst->channels != 1) return 0;
+
+	// Converter imagem Gray para Binária: v < threshold -> 0, caso contrário 255
+	vc_lut_identity(&lut);
+	vc_lut_threshold(&lut, threshold);
+	if (!vc_gray_apply_lut(src, dst, &lut)) return 0;
+
+	// Definir o número de níveis da imagem de destino para 2 (binária)
+	dst->levels = 2;
+
 	return 1;
 }
 
+/**
+ * @brief Obtém o negativo de uma imagem binarizada.
+ * @author lugon
+ * @param image Ponteiro para a estrutura IVC que representa a imagem binarizada.
+ * Esta estrutura deve ser pré-alocada e conter dados válidos de imagem.
+ */
+void vc_binary_get_negative(IVC* image)
+{
+	LVC lut;
+
+	// Aplica o negativo trocando pixels pretos (0) por brancos (255) e os restantes por pretos
+	vc_lut_identity(&lut);
+	vc_lut_binary_negative(&lut);
+	vc_gray_apply_lut(image, image, &lut);
+}
+
+/**
+ * @brief Converte uma imagem em escala de cinza para binária usando a média global como valor de threshold.
+ * @author lugon
+ * @param src Ponteiro para a estrutura IVC que representa a imagem em escala de cinza de entrada.
+ * @param dst Ponteiro para a estrutura IVC que representa a imagem binária de saída.
+ * @return int Retorna 1 se a conversão foi bem-sucedida, 0 se houve um erro, como dimensões inválidas ou formato de cor incorreto.
+ */
+int vc_gray_to_binary_global_mean(IVC* src, IVC* dst)
+{
+	// A média é obtida do histograma, pelo que a imagem só é percorrida uma vez antes da binarização
+	return vc_gray_to_binary_auto(src, dst, VC_THRESHOLD_MEAN, NULL);
+}
+
+/**
+ * @brief Converte uma imagem em escala de cinza para binária usando o método Midpoint com um kernel.
+ * O mínimo e o máximo locais são obtidos por vc_gray_min_max_filter(), com custo independente do kernel.
+ * @author lugon
+ * @param src Ponteiro para a estrutura IVC que representa a imagem em escala de cinza de entrada.
+ * @param dst Ponteiro para a estrutura IVC que representa a imagem binária de saída (0/1).
+ * @param kernel Tamanho do kernel a ser usado para a conversão.
+ * @return int Retorna 1 se a conversão foi bem-sucedida, 0 se houve um erro, como dimensões inválidas ou formato de cor incorreto.
+ */
+int vc_gray_to_binary_kernel_midpoint(IVC* src, IVC* dst, int kernel)
+{
+	return vc_gray_to_binary_midpoint(src, dst, kernel, 1);
+}
+
 /**
  * @brief Aplica a dilatação binária em uma imagem binária de entrada.
+ * O kernel é quadrado, de lado 2 * (kernel / 2) + 1, e os vizinhos fora da imagem são ignorados.
+ * É calculada sobre a máscara compactada (vc_bitmask_dilate), 64 pixels por operação.
+ * Na borda, o resultado é o mesmo que com VC_BORDER_DEFAULT (ver vc_gray_min_max_filter).
  * @author lugon
  * @param src Ponteiro para a estrutura IVC que representa a imagem binária de entrada.
  * @param dst Ponteiro para a estrutura IVC que representa a imagem binária de saída.
- * @param kernel Tamanho do kernel a ser usado para a dilatação.
+ * @param kernel Tamanho do kernel a ser usado para a dilatação (um kernel inferior a 1 equivale a 1, janela 1x1).
  * @return int Retorna 1 se a dilatação foi bem-sucedida, 0 se houve um erro, como dimensões inválidas ou formato de cor incorreto.
  */
 int vc_binary_dilate(IVC* src, IVC* dst, int kernel)
 {
-	int width = src->width;
-	int height = src->height;
-	int bytesperline = src->width * src->channels;
-	int channels = src->channels;
+	int op = VC_MORPH_DILATE;
 
-	int bytesperline_dst = dst->width * dst->channels;
-
-	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL))
-		return 0;
-	if ((dst->width <= 0) || (dst->height <= 0))
-		return 0;
-	if ((src->channels != 1) || (dst->channels != 1))
-		return 0;
-
-	for (int y = 0; y < height; y++)
-	{
-		for (int x = 0; x < width; x++)
-		{
-			int pos_dst = y * bytesperline_dst + x * channels;
-			int pixel = 0;
+	// Como no ciclo original, kernel 0 (ou -1) é uma janela 1x1: dst fica com a imagem reduzida a 0/255
+	if (kernel < 1) kernel = 1;
 
-			for (int yy = -kernel / 2; yy <= kernel / 2; yy++)
-			{
-				for (int xx = -kernel / 2; xx <= kernel / 2; xx++)
-				{
-					if (y + yy >= 0 && y + yy < height && x + xx >= 0 && x + xx < width)
-					{
-						int pos_src = (y + yy) * bytesperline + (x + xx) * channels;
-						if (src->data[pos_src] == 255)
-						{
-							pixel = 255;
-						}
-					}
-				}
-			}
-			dst->data[pos_dst] = pixel;
-		}
-	}
-	return 1;
+	return vc_binary_morphology_sequence(src, dst, &op, &kernel, 1);
 }
 
 /**
  * @brief Aplica a erosão binária em uma imagem binária de entrada.
+ * O kernel é quadrado, de lado 2 * (kernel / 2) + 1, e os vizinhos fora da imagem são ignorados.
+ * É calculada sobre a máscara compactada (vc_bitmask_erode), 64 pixels por operação.
+ * Na borda, o resultado é o mesmo que com VC_BORDER_DEFAULT (ver vc_gray_min_max_filter).
  * @author lugon
  * @param src Ponteiro para a estrutura IVC que representa a imagem binária de entrada.
  * @param dst Ponteiro para a estrutura IVC que representa a imagem binária de saída.
- * @param kernel Tamanho do kernel a ser usado para a erosão.
+ * @param kernel Tamanho do kernel a ser usado para a erosão (um kernel inferior a 1 equivale a 1, janela 1x1).
  * @return int Retorna 1 se a erosão foi bem-sucedida, 0 se houve um erro, como dimensões inválidas ou formato de cor incorreto.
  */
 int vc_binary_erode(IVC* src, IVC* dst, int kernel)
 {
-	int width = src->width;
-	int height = src->height;
-	int bytesperline = src->width * src->channels;
-	int channels = src->channels;
-
-	int bytesperline_dst = dst->width * dst->channels;
+	int op = VC_MORPH_ERODE;
 
-	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL))
-		return 0;
-	if ((dst->width <= 0) || (dst->height <= 0))
-		return 0;
-	if ((src->channels != 1) || (dst->channels != 1))
-		return 0;
-
-	for (int y = 0; y < height; y++)
-	{
-		for (int x = 0; x < width; x++)
-		{
-			int pos_dst = y * bytesperline_dst + x * channels;
-			int pixel = 255;
+	// Como no ciclo original, kernel 0 (ou -1) é uma janela 1x1: dst fica com a imagem reduzida a 0/255
+	if (kernel < 1) kernel = 1;
 
-			for (int yy = -kernel / 2; yy <= kernel / 2; yy++)
-			{
-				for (int xx = -kernel / 2; xx <= kernel / 2; xx++)
-				{
-					if (y + yy >= 0 && y + yy < height && x + xx >= 0 && x + xx < width)
-					{
-						int pos_src = (y + yy) * bytesperline + (x + xx) * channels;
-						if (src->data[pos_src] == 0)
-						{
-							pixel = 0;
-						}
-					}
-				}
-			}
-			dst->data[pos_dst] = pixel;
-		}
-	}
-	return 1;
+	return vc_binary_morphology_sequence(src, dst, &op, &kernel, 1);
 }
 
 /**
@@ -1152,11 +1212,6 @@ int vc_binary_erode(IVC* src, IVC* dst, int kernel)
  */
 int vc_gray_histogram_show(IVC* src, IVC* dst)
 {
-	// Informações da imagem de origem
-	unsigned char* datasrc = (unsigned char*)src->data; // Dados da imagem de origem
-	int bytesperline_src = src->width * src->channels;  // Bytes por linha na imagem de origem
-	int channels_src = src->channels;                   // Número de canais de cor na imagem de origem
-
 	// Informações da imagem de destino
 	unsigned char* datadst = (unsigned char*)dst->data; // Dados da imagem de destino
 	int bytesperline_dst = dst->width * dst->channels;  // Bytes por linha na imagem de destino
@@ -1167,9 +1222,7 @@ int vc_gray_histogram_show(IVC* src, IVC* dst)
 	int height = src->height;
 
 	// Variáveis auxiliares
-	int x, y, hist[256] = { 0 }, max = 0;
-	long int pos_src, pos_dst;
-	int total = height * width; // Total de pixels na imagem
+	int y, hist[256], max = 0;
 	float pdf[256];             // Probability density function
 
 	// Verificação de erros
@@ -1178,14 +1231,7 @@ int vc_gray_histogram_show(IVC* src, IVC* dst)
 	if ((src->channels != 1) || (dst->channels != 1)) return 0;
 
 	// Calcula o histograma
-	for (y = 0; y < height; y++)
-	{
-		for (x = 0; x < width; x++)
-		{
-			pos_src = y * bytesperline_src + x * channels_src; // Calcula posição do pixel na imagem de origem
-			hist[datasrc[pos_src]]++;                         // Incrementa o histograma no valor do pixel
-		}
-	}
+	if (!vc_gray_histogram(src, hist)) return 0;
 
 	// Encontra o valor máximo no histograma
 	for (int i = 0; i < 256; i++)
@@ -1227,272 +1273,574 @@ int vc_gray_histogram_show(IVC* src, IVC* dst)
  */
 int vc_gray_histogram_equalization(IVC* src, IVC* dst)
 {
-	// info source
-	unsigned char* datasrc = (unsigned char*)src->data;
-	int bytesperline_src = src->width * src->channels;
-	int channels_src = src->channels;
-
-	//info destino
-	unsigned char* datadst = (unsigned char*)dst->data;
-	int bytesperline_dst = dst->width * dst->channels;
-	int channels_dst = dst->channels;
-
-	// medidas
-	int width = src->width;
-	int height = src->height;
-
-	//auxiliares gerais
-	int x, y, hist[256] = { 0 }, max = 0;
-	long int pos_src, pos_dst;
-	int total = height * width;//maximo de pixeis
-	float pdf[256], min = 256, cdf[256];
+	LVC lut;
 
 	//verificação de erros
 	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
 	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
 	if ((src->channels != 1) || (dst->channels != 1)) return 0;
 
-	for (y = 0;y < height;y++)
-	{
-		for (x = 0;x < width; x++)
-		{
-			pos_src = y * bytesperline_src + x * channels_src;//posicao da source
-			pos_dst = y * bytesperline_dst + x * channels_dst;//posicao destino
+	// Calcula a transformação de equalização e aplica-a numa única passagem
+	vc_lut_identity(&lut);
+	if (!vc_lut_equalization(&lut, src)) return 0;
 
-			//conta ocorrencias de cada valor de pixel
-			hist[datasrc[pos_src]]++;
-		}
-	}
-	for (int i = 0; i < 256; i++)
+	return vc_gray_apply_lut(src, dst, &lut);
+}
+
+// Estatísticas de um blob, acumuladas numa única passagem pela imagem. As somas de 3ª ordem são
+// guardadas em double, porque em imagens grandes podem exceder 64 bits.
+typedef struct {
+	int area, perimeter;
+	int xmin, ymin, xmax, ymax;
+	long long sumx, sumy, sumxx, sumxy, sumyy;
+	double sumxxx, sumxxy, sumxyy, sumyyy;
+} vc_blob_acc;
+
+static void vc_blob_acc_init(vc_blob_acc* acc, int n, int width, int height)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
 	{
-		pdf[i] = (float)hist[i] / total;//total para equalização
-		if ((pdf[i] < min) && (pdf[i] != 0)) min = pdf[i];//saber mínimo do pdf
+		acc[i].area = 0;
+		acc[i].perimeter = 0;
+		acc[i].xmin = width - 1;
+		acc[i].ymin = height - 1;
+		acc[i].xmax = 0;
+		acc[i].ymax = 0;
+		acc[i].sumx = 0;
+		acc[i].sumy = 0;
+		acc[i].sumxx = 0;
+		acc[i].sumxy = 0;
+		acc[i].sumyy = 0;
+		acc[i].sumxxx = 0.0;
+		acc[i].sumxxy = 0.0;
+		acc[i].sumxyy = 0.0;
+		acc[i].sumyyy = 0.0;
 	}
+}
 
-	for (int i = 0; i < 256; i++)
+// Estatísticas vazias de um blob cujo primeiro pixel (em ordem de varrimento) é (x, y): a caixa
+// delimitadora começa nesse pixel, em vez de na imagem inteira
+static void vc_blob_acc_seed(vc_blob_acc* acc, int x, int y)
+{
+	vc_blob_acc_init(acc, 1, 1, 1);
+	acc->xmin = x;
+	acc->ymin = y;
+	acc->xmax = x;
+	acc->ymax = y;
+}
+
+// Junta o pixel (x, y) às estatísticas; border != 0 se algum dos 4 vizinhos não pertence ao blob
+static void vc_blob_acc_add(vc_blob_acc* acc, int x, int y, int border)
+{
+	long long xx = (long long)x * x, xy = (long long)x * y, yy = (long long)y * y;
+
+	acc->area++;
+	acc->sumx += x;
+	acc->sumy += y;
+	acc->sumxx += xx;
+	acc->sumxy += xy;
+	acc->sumyy += yy;
+	acc->sumxxx += (double)(xx * x);
+	acc->sumxxy += (double)(xx * y);
+	acc->sumxyy += (double)(xy * y);
+	acc->sumyyy += (double)(yy * y);
+	if (acc->xmin > x) acc->xmin = x;
+	if (acc->ymin > y) acc->ymin = y;
+	if (acc->xmax < x) acc->xmax = x;
+	if (acc->ymax < y) acc->ymax = y;
+	if (border) acc->perimeter++;
+}
+
+// Junta o segmento [xstart, xend] da linha y às estatísticas (sem o perímetro), com as somas das
+// potências de x em forma fechada: o custo não depende do comprimento do segmento
+static void vc_blob_acc_add_run(vc_blob_acc* acc, int y, int xstart, int xend)
+{
+	long long a = xstart - 1, b = xend, len = b - a;
+	long long s1 = (b * (b + 1) - a * (a + 1)) / 2;
+	long long s2 = (b * (b + 1) * (2 * b + 1) - a * (a + 1) * (2 * a + 1)) / 6;
+	double s3 = (double)(b * (b + 1) / 2) * (double)(b * (b + 1) / 2) - (double)(a * (a + 1) / 2) * (double)(a * (a + 1) / 2);
+
+	acc->area += (int)len;
+	acc->sumx += s1;
+	acc->sumy += len * y;
+	acc->sumxx += s2;
+	acc->sumxy += s1 * y;
+	acc->sumyy += len * y * y;
+	acc->sumxxx += s3;
+	acc->sumxxy += (double)s2 * y;
+	acc->sumxyy += (double)s1 * y * y;
+	acc->sumyyy += (double)len * y * y * y;
+	if (acc->xmin > xstart) acc->xmin = xstart;
+	if (acc->ymin > y) acc->ymin = y;
+	if (acc->xmax < xend) acc->xmax = xend;
+	if (acc->ymax < y) acc->ymax = y;
+}
+
+// Junta as estatísticas de src às de dst (partes do mesmo blob)
+static void vc_blob_acc_merge(vc_blob_acc* dst, vc_blob_acc* src)
+{
+	dst->area += src->area;
+	dst->perimeter += src->perimeter;
+	dst->sumx += src->sumx;
+	dst->sumy += src->sumy;
+	dst->sumxx += src->sumxx;
+	dst->sumxy += src->sumxy;
+	dst->sumyy += src->sumyy;
+	dst->sumxxx += src->sumxxx;
+	dst->sumxxy += src->sumxxy;
+	dst->sumxyy += src->sumxyy;
+	dst->sumyyy += src->sumyyy;
+	if (dst->xmin > src->xmin) dst->xmin = src->xmin;
+	if (dst->ymin > src->ymin) dst->ymin = src->ymin;
+	if (dst->xmax < src->xmax) dst->xmax = src->xmax;
+	if (dst->ymax < src->ymax) dst->ymax = src->ymax;
+}
+
+// Calcula os momentos centrais, a orientação e os eixos do blob a partir dos momentos brutos.
+// Os momentos centrais de 3ª ordem usam as expressões de mu_pq em função dos m_pq.
+static void vc_blob_moments_update(OVC* blob)
+{
+	MVC* m = &blob->moments;
+	double xm, ym, a, b, c, d;
+
+	if (m->m00 <= 0.0)
 	{
-		if (i != 0) cdf[i] = cdf[i - 1] + pdf[i];//acumulada
-		else cdf[0] = pdf[0];
+		m->mu20 = m->mu11 = m->mu02 = 0.0;
+		m->mu30 = m->mu21 = m->mu12 = m->mu03 = 0.0;
+		blob->angle = blob->major = blob->minor = 0.0f;
+		return;
 	}
-	//--------------------------------------------------------
-	//GERAR IMAGEM
-	for (y = 0;y < height;y++)
-	{
-		for (x = 0;x < width; x++)
-		{
-			pos_src = y * bytesperline_src + x * channels_src;//posicao da source
-			pos_dst = y * bytesperline_dst + x * channels_dst;//posicao destino
 
-			datadst[y * bytesperline_dst + x * channels_dst] = ((cdf[datasrc[pos_src]] - min) / (1 - min)) * (255 - 1);
-		}
-	}
-	//---------------------------------------------------------
-	return 1;
+	xm = m->m10 / m->m00;
+	ym = m->m01 / m->m00;
+
+	m->mu20 = m->m20 - xm * m->m10;
+	m->mu11 = m->m11 - xm * m->m01;
+	m->mu02 = m->m02 - ym * m->m01;
+	m->mu30 = m->m30 - 3.0 * xm * m->m20 + 2.0 * xm * xm * m->m10;
+	m->mu21 = m->m21 - 2.0 * xm * m->m11 - ym * m->m20 + 2.0 * xm * xm * m->m01;
+	m->mu12 = m->m12 - 2.0 * ym * m->m11 - xm * m->m02 + 2.0 * ym * ym * m->m10;
+	m->mu03 = m->m03 - 3.0 * ym * m->m02 + 2.0 * ym * ym * m->m01;
+
+	// Valores próprios da matriz de covariância: variâncias ao longo dos eixos principais
+	a = m->mu20 / m->m00;
+	b = m->mu11 / m->m00;
+	c = m->mu02 / m->m00;
+	d = sqrt(4.0 * b * b + (a - c) * (a - c));
+
+	blob->angle = (float)(0.5 * atan2(2.0 * b, a - c));
+	blob->major = (float)(4.0 * sqrt(MAX((a + c + d) / 2.0, 0.0)));
+	blob->minor = (float)(4.0 * sqrt(MAX((a + c - d) / 2.0, 0.0)));
 }
 
-/**
- * @brief Etiquetagem de blobs em uma imagem binária.
- * @author lugon
- * @param src Imagem binária de entrada.
- * @param dst Imagem grayscale onde as etiquetas serão armazenadas.
- * @param nlabels Endereço de memória de uma variável onde será armazenado o número de etiquetas encontradas.
- * @return OVC* Retorna um array de estruturas de blobs (objetos), com respectivas etiquetas.
- */
-OVC* vc_binary_blob_labelling(IVC* src, IVC* dst, int* nlabels)
+// Preenche a área, a caixa delimitadora, o centro de gravidade, o perímetro e os momentos do blob
+// (mantém a etiqueta)
+static void vc_blob_acc_finish(vc_blob_acc* acc, OVC* blob)
 {
-	unsigned char* datasrc = (unsigned char*)src->data;
-	unsigned char* datadst = (unsigned char*)dst->data;
-	int width = src->width;
-	int height = src->height;
-	int bytesperline = src->bytesperline;
-	int channels = src->channels;
-	int x, y, a, b;
-	long int i, size;
-	long int posX, posA, posB, posC, posD;
-	int labeltable[256] = { 0 };
-	int labelarea[256] = { 0 };
-	int label = 1; // Etiqueta inicial.
-	int num, tmplabel;
-	OVC* blobs; // Apontador para array de blobs (objetos) que será retornado desta função.
-
-	// Verificação de erros
-	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
-	if ((src->width != dst->width) || (src->height != dst->height) || (src->channels != dst->channels)) return NULL;
-	if (channels != 1) return NULL;
+	blob->area = acc->area;
+	blob->perimeter = acc->perimeter;
+
+	// Bounding Box
+	blob->x = acc->xmin;
+	blob->y = acc->ymin;
+	blob->width = (acc->xmax - acc->xmin) + 1;
+	blob->height = (acc->ymax - acc->ymin) + 1;
+
+	// Centro de Gravidade
+	blob->xc = (int)(acc->sumx / MAX(acc->area, 1));
+	blob->yc = (int)(acc->sumy / MAX(acc->area, 1));
+
+	// Momentos
+	blob->moments.m00 = (double)acc->area;
+	blob->moments.m10 = (double)acc->sumx;
+	blob->moments.m01 = (double)acc->sumy;
+	blob->moments.m20 = (double)acc->sumxx;
+	blob->moments.m11 = (double)acc->sumxy;
+	blob->moments.m02 = (double)acc->sumyy;
+	blob->moments.m30 = acc->sumxxx;
+	blob->moments.m21 = acc->sumxxy;
+	blob->moments.m12 = acc->sumxyy;
+	blob->moments.m03 = acc->sumyyy;
+	vc_blob_moments_update(blob);
+}
 
-	// Copia dados da imagem binária para imagem grayscale
-	memcpy(datadst, datasrc, bytesperline * height);
+// Raiz da etiqueta provisória a, com compressão do caminho
+static int vc_uf_find(int* parent, int a)
+{
+	int root = a, next;
 
-	// Todos os pixels de plano de fundo devem obrigatoriamente ter valor 0
-	// Todos os pixels de primeiro plano devem obrigatoriamente ter valor 255
-	// Serão atribuídas etiquetas no intervalo [1,254]
-	// Este algoritmo está assim limitado a 254 labels
-	for (i = 0, size = bytesperline * height; i < size; i++)
+	while (parent[root] != root) root = parent[root];
+	while (parent[a] != root)
 	{
-		if (datadst[i] != 0) datadst[i] = 255;
+		next = parent[a];
+		parent[a] = root;
+		a = next;
 	}
 
-	// Limpa os rebordos da imagem binária
-	for (y = 0; y < height; y++)
+	return root;
+}
+
+// Junta as classes de a e b; a raiz é sempre a menor etiqueta. Devolve a raiz.
+static int vc_uf_union(int* parent, int a, int b)
+{
+	a = vc_uf_find(parent, a);
+	b = vc_uf_find(parent, b);
+	if (a < b) parent[b] = a;
+	else parent[a] = b;
+
+	return MIN(a, b);
+}
+
+// Pixel (x, y) de frente, dentro da imagem (e fora do rebordo, se skipborder != 0)
+static int vc_binary_is_fg(IVC* src, int x, int y, int skipborder)
+{
+	int b = skipborder ? 1 : 0;
+
+	if ((x < b) || (y < b) || (x >= src->width - b) || (y >= src->height - b)) return 0;
+
+	return src->data[(long int)y * src->bytesperline + x] != 0;
+}
+
+// Primeira passagem da etiquetagem nas linhas [y0, y1[, com etiquetas provisórias a partir de base.
+// A árvore de decisão de Wu consulta os vizinhos B, C, A e D por esta ordem e faz no máximo uma união
+// por pixel. A primeira linha da faixa não consulta a linha anterior (a costura entre faixas é tratada
+// em vc_binary_label_seam), pelo que faixas diferentes podem ser etiquetadas em paralelo.
+// Devolve a próxima etiqueta livre.
+static int vc_binary_label_strip(IVC* src, int* labels, int* parent, int y0, int y1, int base, int skipborder)
+{
+	int width = src->width, height = src->height;
+	int x, y, next = base, *row, *prev;
+	unsigned char* line;
+
+	for (y = y0; y < y1; y++)
 	{
-		datadst[y * bytesperline + 0 * channels] = 0;
-		datadst[y * bytesperline + (width - 1) * channels] = 0;
+		line = src->data + (long int)y * src->bytesperline;
+		row = labels + (long int)y * width;
+		prev = (y > y0) ? row - width : NULL;
+
+		memset(row, 0, (size_t)width * sizeof(int));
+
+		for (x = 0; x < width; x++)
+		{
+#if defined(VC_SSE2)
+			// Salta blocos de 16 pixels de fundo
+			while ((x + 16 <= width) && (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(line + x)), _mm_setzero_si128())) == 0xFFFF)) x += 16;
+			if (x >= width) break;
+#endif
+			if ((line[x] == 0) || (skipborder && ((x == 0) || (y == 0) || (x == width - 1) || (y == height - 1)))) continue;
+
+			// Kernel:
+			// A B C
+			// D X
+			if ((prev != NULL) && prev[x])
+			{
+				row[x] = prev[x];
+			}
+			else if ((prev != NULL) && (x + 1 < width) && prev[x + 1])
+			{
+				row[x] = prev[x + 1];
+				if ((x > 0) && prev[x - 1]) vc_uf_union(parent, prev[x + 1], prev[x - 1]);
+				else if ((x > 0) && row[x - 1]) vc_uf_union(parent, prev[x + 1], row[x - 1]);
+			}
+			else if ((prev != NULL) && (x > 0) && prev[x - 1])
+			{
+				row[x] = prev[x - 1];
+			}
+			else if ((x > 0) && row[x - 1])
+			{
+				row[x] = row[x - 1];
+			}
+			else
+			{
+				parent[next] = next;
+				row[x] = next++;
+			}
+		}
 	}
+
+	return next;
+}
+
+// Junta as etiquetas da linha y (primeira de uma faixa) às dos vizinhos A, B e C na linha y - 1
+static void vc_binary_label_seam(int* labels, int* parent, int width, int y)
+{
+	int x, *row = labels + (long int)y * width, *prev = row - width;
+
 	for (x = 0; x < width; x++)
 	{
-		datadst[0 * bytesperline + x * channels] = 0;
-		datadst[(height - 1) * bytesperline + x * channels] = 0;
+		if (row[x] == 0) continue;
+
+		if (prev[x]) vc_uf_union(parent, row[x], prev[x]);
+		else
+		{
+			if ((x > 0) && prev[x - 1]) vc_uf_union(parent, row[x], prev[x - 1]);
+			if ((x + 1 < width) && prev[x + 1]) vc_uf_union(parent, row[x], prev[x + 1]);
+		}
+	}
+}
+
+// Etiquetagem em duas passagens com union-find (vizinhança 8), em nstrips faixas horizontais.
+// Cada faixa usa um intervalo próprio de etiquetas provisórias (no máximo uma por bloco 2x2), de modo
+// que as primeiras passagens das faixas correm em paralelo sem partilhar nós da floresta; as costuras
+// são depois juntadas em série (custo proporcional a width * nstrips). As raízes são numeradas 1..n
+// pela ordem de aparecimento, pelo que o resultado não depende do número de faixas. Se skipborder != 0,
+// os pixels do rebordo da imagem são tratados como fundo. Se blobs != NULL, a segunda passagem também
+// calcula as estatísticas de cada blob, por faixa e por etiqueta provisória, juntando-as no fim
+// (*blobs fica com um array de n blobs, ou NULL se n = 0).
+// Devolve n, ou -1 se faltar memória.
+static int vc_binary_label_uf(IVC* src, int* labels, int skipborder, int nstrips, OVC** blobs)
+{
+	int width = src->width, height = src->height;
+	int s, x, a, n = 0, *parent, *y0, *base, *next, *offset;
+	vc_blob_acc *acc = NULL, *pacc = NULL;
+
+	nstrips = MAX(1, MIN(nstrips, height));
+
+	// Limites, etiqueta inicial, próxima etiqueta livre e deslocamento dos acumuladores de cada faixa
+	y0 = (int*)malloc((size_t)4 * (nstrips + 1) * sizeof(int));
+	if (y0 == NULL) return -1;
+	base = y0 + (nstrips + 1);
+	next = base + (nstrips + 1);
+	offset = next + (nstrips + 1);
+
+	base[0] = 1;
+	for (s = 0; s <= nstrips; s++)
+	{
+		y0[s] = (int)(((long long)s * height) / nstrips);
+		if (s > 0) base[s] = base[s - 1] + ((width + 1) / 2) * ((y0[s] - y0[s - 1] + 1) / 2);
 	}
 
-	// Efectua a etiquetagem
-	for (y = 1; y < height - 1; y++)
+	parent = (int*)malloc((size_t)base[nstrips] * sizeof(int));
+	if (parent == NULL)
 	{
-		for (x = 1; x < width - 1; x++)
+		free(y0);
+		return -1;
+	}
+	parent[0] = 0;
+
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+	for (s = 0; s < nstrips; s++)
+	{
+		next[s] = vc_binary_label_strip(src, labels, parent, y0[s], y0[s + 1], base[s], skipborder);
+	}
+
+	for (s = 1; s < nstrips; s++) vc_binary_label_seam(labels, parent, width, y0[s]);
+
+	// Numeração final, guardada como -etiqueta: como a raiz é sempre a menor etiqueta (e as faixas
+	// seguintes usam etiquetas maiores), parent[a] < a para as restantes, e parent[parent[a]] já tem a
+	// etiqueta final quando a é visitada
+	for (s = 0; s < nstrips; s++)
+	{
+		for (a = base[s]; a < next[s]; a++)
 		{
-			// Kernel:
-			// A B C
-			// D X
+			if (parent[a] == a) parent[a] = -(++n);
+			else parent[a] = parent[parent[a]];
+		}
+	}
+
+	if (blobs != NULL)
+	{
+		*blobs = NULL;
+		offset[0] = 0;
+		for (s = 0; s < nstrips; s++) offset[s + 1] = offset[s] + (next[s] - base[s]);
+
+		acc = (vc_blob_acc*)malloc((size_t)MAX(n, 1) * sizeof(vc_blob_acc));
+		pacc = (vc_blob_acc*)malloc((size_t)MAX(offset[nstrips], 1) * sizeof(vc_blob_acc));
+		if (n > 0) *blobs = (OVC*)calloc(n, sizeof(OVC));
+		if ((acc == NULL) || (pacc == NULL) || ((n > 0) && (*blobs == NULL)))
+		{
+			free(acc);
+			free(pacc);
+			free(*blobs);
+			*blobs = NULL;
+			free(parent);
+			free(y0);
+			return -1;
+		}
+		vc_blob_acc_init(acc, n, width, height);
+		vc_blob_acc_init(pacc, offset[nstrips], width, height);
+	}
 
-			posA = (y - 1) * bytesperline + (x - 1) * channels; // A
-			posB = (y - 1) * bytesperline + x * channels; // B
-			posC = (y - 1) * bytesperline + (x + 1) * channels; // C
-			posD = y * bytesperline + (x - 1) * channels; // D
-			posX = y * bytesperline + x * channels; // X
+	// Segunda passagem, também por faixas: cada faixa só contém as suas etiquetas provisórias. Um pixel
+	// é de contorno se algum dos 4 vizinhos é fundo ou está fora da imagem (blobs diferentes nunca são
+	// vizinhos)
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+	for (s = 0; s < nstrips; s++)
+	{
+		int sx, sy, *srow;
 
-			// Se o pixel foi marcado
-			if (datadst[posX] != 0)
+		for (sy = y0[s]; sy < y0[s + 1]; sy++)
+		{
+			srow = labels + (long int)sy * width;
+			for (sx = 0; sx < width; sx++)
 			{
-				if ((datadst[posA] == 0) && (datadst[posB] == 0) && (datadst[posC] == 0) && (datadst[posD] == 0))
-				{
-					datadst[posX] = label;
-					labeltable[label] = label;
-					label++;
-				}
-				else
+				if (srow[sx] == 0) continue;
+				if (pacc != NULL)
 				{
-					num = 255;
-
-					// Se A está marcado
-					if (datadst[posA] != 0) num = labeltable[datadst[posA]];
-					// Se B está marcado, e é menor que a etiqueta "num"
-					if ((datadst[posB] != 0) && (labeltable[datadst[posB]] < num)) num = labeltable[datadst[posB]];
-					// Se C está marcado, e é menor que a etiqueta "num"
-					if ((datadst[posC] != 0) && (labeltable[datadst[posC]] < num)) num = labeltable[datadst[posC]];
-					// Se D está marcado, e é menor que a etiqueta "num"
-					if ((datadst[posD] != 0) && (labeltable[datadst[posD]] < num)) num = labeltable[datadst[posD]];
-
-					// Atribui a etiqueta ao pixel
-					datadst[posX] = num;
-					labeltable[num] = num;
-
-					// Actualiza a tabela de etiquetas
-					if (datadst[posA] != 0)
-					{
-						if (labeltable[datadst[posA]] != num)
-						{
-							for (tmplabel = labeltable[datadst[posA]], a = 1; a < label; a++)
-							{
-								if (labeltable[a] == tmplabel)
-								{
-									labeltable[a] = num;
-								}
-							}
-						}
-					}
-					if (datadst[posB] != 0)
-					{
-						if (labeltable[datadst[posB]] != num)
-						{
-							for (tmplabel = labeltable[datadst[posB]], a = 1; a < label; a++)
-							{
-								if (labeltable[a] == tmplabel)
-								{
-									labeltable[a] = num;
-								}
-							}
-						}
-					}
-					if (datadst[posC] != 0)
-					{
-						if (labeltable[datadst[posC]] != num)
-						{
-							for (tmplabel = labeltable[datadst[posC]], a = 1; a < label; a++)
-							{
-								if (labeltable[a] == tmplabel)
-								{
-									labeltable[a] = num;
-								}
-							}
-						}
-					}
-					if (datadst[posD] != 0)
-					{
-						if (labeltable[datadst[posD]] != num)
-						{
-							for (tmplabel = labeltable[datadst[posD]], a = 1; a < label; a++)
-							{
-								if (labeltable[a] == tmplabel)
-								{
-									labeltable[a] = num;
-								}
-							}
-						}
-					}
+					vc_blob_acc_add(&pacc[offset[s] + srow[sx] - base[s]], sx, sy, (sx == 0) || (sy == 0) || (sx == width - 1) || (sy == height - 1) ||
+						!vc_binary_is_fg(src, sx - 1, sy, skipborder) || !vc_binary_is_fg(src, sx + 1, sy, skipborder) ||
+						!vc_binary_is_fg(src, sx, sy - 1, skipborder) || !vc_binary_is_fg(src, sx, sy + 1, skipborder));
 				}
+				srow[sx] = -parent[srow[sx]];
 			}
 		}
 	}
 
-	// Volta a etiquetar a imagem
-	for (y = 1; y < height - 1; y++)
+	if (blobs != NULL)
 	{
-		for (x = 1; x < width - 1; x++)
+		// Junta as estatísticas das etiquetas provisórias de cada blob
+		for (s = 0; s < nstrips; s++)
 		{
-			posX = y * bytesperline + x * channels; // X
+			for (a = base[s]; a < next[s]; a++) vc_blob_acc_merge(&acc[-parent[a] - 1], &pacc[offset[s] + a - base[s]]);
+		}
 
-			if (datadst[posX] != 0)
-			{
-				datadst[posX] = labeltable[datadst[posX]];
-			}
+		for (x = 0; x < n; x++)
+		{
+			(*blobs)[x].label = x + 1;
+			vc_blob_acc_finish(&acc[x], &(*blobs)[x]);
 		}
 	}
 
-	// Contagem do número de blobs
-	// Passo 1: Eliminar, da tabela, etiquetas repetidas
-	for (a = 1; a < label - 1; a++)
+	free(acc);
+	free(pacc);
+	free(parent);
+	free(y0);
+
+	return n;
+}
+
+/**
+ * @brief Etiquetagem de blobs com etiquetas de 32 bits (vizinhança 8), sem limite de blobs.
+ * Union-find com compressão de caminhos, em tempo linear no número de pixels. A área, a caixa
+ * delimitadora, o centro de gravidade e o perímetro (pixels com algum dos 4 vizinhos fora do blob)
+ * são calculados na segunda passagem, pelo que não é preciso chamar vc_binary_blob_info.
+ * @author lugon
+ * @param src Imagem binária de entrada (frente != 0).
+ * @param labels Etiquetas, width x height (alocado pelo chamador): 0 = fundo, 1..nlabels = blob.
+ * @param nlabels Endereço de memória de uma variável onde será armazenado o número de etiquetas encontradas.
+ * @return OVC* Array de nlabels blobs, com blobs[i].label = i + 1, ou NULL se não há blobs ou houve um erro.
+ */
+OVC* vc_binary_blob_labelling32(IVC* src, int* labels, int* nlabels)
+{
+	OVC* blobs = NULL;
+	int n;
+
+	*nlabels = 0;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL) || (labels == NULL)) return NULL;
+	if (src->channels != 1) return NULL;
+
+	n = vc_binary_label_uf(src, labels, 0, 1, &blobs);
+	if (n <= 0) return NULL;
+
+	*nlabels = n;
+
+	return blobs;
+}
+
+/**
+ * @brief Etiquetagem de blobs com etiquetas de 32 bits (vizinhança 8), em paralelo por faixas de linhas.
+ * As faixas são etiquetadas independentemente (OpenMP) e as equivalências nas costuras são juntadas
+ * depois; as etiquetas e os blobs são iguais aos de vc_binary_blob_labelling32, qualquer que seja o
+ * número de faixas. Sem OpenMP, as faixas são processadas em série.
+ * @author lugon
+ * @param src Imagem binária de entrada (frente != 0).
+ * @param labels Etiquetas, width x height (alocado pelo chamador): 0 = fundo, 1..n = blob.
+ * @param nstrips Número de faixas (<= 0: uma por thread).
+ * @param blobs Endereço onde será guardado o array de n blobs (NULL se n = 0), com área, caixa
+ * delimitadora, centro de gravidade e perímetro; se blobs = NULL, as estatísticas não são calculadas.
+ * @return int Número de blobs n, ou -1 em caso de erro.
+ */
+int vc_binary_blob_labelling_parallel(IVC* src, int* labels, int nstrips, OVC** blobs)
+{
+	if (blobs != NULL) *blobs = NULL;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL) || (labels == NULL)) return -1;
+	if (src->channels != 1) return -1;
+
+	if (nstrips <= 0)
 	{
-		for (b = a + 1; b < label; b++)
-		{
-			if (labeltable[a] == labeltable[b]) labeltable[b] = 0;
-		}
+#if defined(_OPENMP)
+		nstrips = omp_get_max_threads();
+#else
+		nstrips = 1;
+#endif
 	}
-	// Passo 2: Conta etiquetas e organiza a tabela de etiquetas, para que não hajam valores vazios (zero) entre etiquetas
+
+	return vc_binary_label_uf(src, labels, 0, nstrips, blobs);
+}
+
+/**
+ * @brief Etiquetagem de blobs em uma imagem binária.
+ * Os pixels do rebordo da imagem são tratados como fundo. As etiquetas são guardadas em 8 bits, pelo
+ * que a função falha (devolve NULL, com nlabels a indicar o número de blobs) se houver mais de 255
+ * blobs; nesse caso deve ser usada vc_binary_blob_labelling32.
+ * @author lugon
+ * @param src Imagem binária de entrada.
+ * @param dst Imagem grayscale onde as etiquetas serão armazenadas.
+ * @param nlabels Endereço de memória de uma variável onde será armazenado o número de etiquetas encontradas.
+ * @return OVC* Retorna um array de estruturas de blobs (objetos), com respectivas etiquetas.
+ */
+OVC* vc_binary_blob_labelling(IVC* src, IVC* dst, int* nlabels)
+{
+	int x, y, a, n;
+	int* labels;
+	OVC* blobs;
+
 	*nlabels = 0;
-	for (a = 1; a < label; a++)
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return NULL;
+	if ((src->width != dst->width) || (src->height != dst->height) || (src->channels != dst->channels)) return NULL;
+	if (src->channels != 1) return NULL;
+
+	labels = (int*)malloc((size_t)src->width * src->height * sizeof(int));
+	if (labels == NULL) return NULL;
+
+	n = vc_binary_label_uf(src, labels, 1, 1, NULL);
+	if (n < 0)
 	{
-		if (labeltable[a] != 0)
-		{
-			labeltable[*nlabels] = labeltable[a]; // Organiza tabela de etiquetas
-			(*nlabels)++; // Conta etiquetas
-		}
+		free(labels);
+		return NULL;
 	}
+	*nlabels = n;
 
-	// Se não há blobs
-	if (*nlabels == 0) return NULL;
+	// Se as etiquetas não cabem em 8 bits
+	if (n > 255)
+	{
+		free(labels);
+		return NULL;
+	}
 
-	// Cria lista de blobs (objetos) e preenche a etiqueta
-	blobs = (OVC*)calloc((*nlabels), sizeof(OVC));
-	if (blobs != NULL)
+	for (y = 0; y < src->height; y++)
 	{
-		for (a = 0; a < (*nlabels); a++) blobs[a].label = labeltable[a];
+		for (x = 0; x < src->width; x++) dst->data[(long int)y * dst->bytesperline + x] = (unsigned char)labels[(long int)y * src->width + x];
 	}
-	else return NULL;
+	free(labels);
+
+	// Se não há blobs
+	if (n == 0) return NULL;
+
+	// Cria lista de blobs (objetos) e preenche a etiqueta
+	blobs = (OVC*)calloc(n, sizeof(OVC));
+	if (blobs == NULL) return NULL;
+	for (a = 0; a < n; a++) blobs[a].label = a + 1;
 
 	return blobs;
 }
 
 /**
  * @brief Calcula as informações dos blobs etiquetados em uma imagem binária.
+ * Todas as estatísticas são acumuladas por etiqueta numa única passagem pela imagem, pelo que o custo
+ * não depende do número de blobs. Os pixels do rebordo da imagem não são considerados.
  * @author lugon
  * @param src Imagem binária com blobs etiquetados.
  * @param blobs Array de estruturas de blobs (objetos) contendo informações dos blobs.
@@ -1508,66 +1856,35 @@ int vc_binary_blob_info(IVC* src, OVC* blobs, int nblobs)
 	int channels = src->channels;
 	int x, y, i;
 	long int pos;
-	int xmin, ymin, xmax, ymax;
-	long int sumx, sumy;
+	unsigned char label;
+	vc_blob_acc acc[256], empty;
 
 	// Verificação de erros
 	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
 	if (channels != 1) return 0;
 
-	// Conta área de cada blob
-	for (i = 0; i < nblobs; i++)
-	{
-		xmin = width - 1;
-		ymin = height - 1;
-		xmax = 0;
-		ymax = 0;
-
-		sumx = 0;
-		sumy = 0;
-
-		blobs[i].area = 0;
+	// Uma entrada por etiqueta possível
+	vc_blob_acc_init(acc, 256, width, height);
+	vc_blob_acc_init(&empty, 1, width, height);
 
-		for (y = 1; y < height - 1; y++)
+	for (y = 1; y < height - 1; y++)
+	{
+		for (x = 1; x < width - 1; x++)
 		{
-			for (x = 1; x < width - 1; x++)
-			{
-				pos = y * bytesperline + x * channels;
+			pos = y * bytesperline + x * channels;
+			label = data[pos];
 
-				if (data[pos] == blobs[i].label)
-				{
-					// Área
-					blobs[i].area++;
-
-					// Centro de Gravidade
-					sumx += x;
-					sumy += y;
-
-					// Bounding Box
-					if (xmin > x) xmin = x;
-					if (ymin > y) ymin = y;
-					if (xmax < x) xmax = x;
-					if (ymax < y) ymax = y;
-
-					// Perímetro
-					// Se pelo menos um dos quatro vizinhos não pertence ao mesmo label, então é um pixel de contorno
-					if ((data[pos - 1] != blobs[i].label) || (data[pos + 1] != blobs[i].label) || (data[pos - bytesperline] != blobs[i].label) || (data[pos + bytesperline] != blobs[i].label))
-					{
-						blobs[i].perimeter++;
-					}
-				}
-			}
+			// Perímetro
+			// Se pelo menos um dos quatro vizinhos não pertence ao mesmo label, então é um pixel de contorno
+			vc_blob_acc_add(&acc[label], x, y, (data[pos - 1] != label) || (data[pos + 1] != label) || (data[pos - bytesperline] != label) || (data[pos + bytesperline] != label));
 		}
+	}
 
-		// Bounding Box
-		blobs[i].x = xmin;
-		blobs[i].y = ymin;
-		blobs[i].width = (xmax - xmin) + 1;
-		blobs[i].height = (ymax - ymin) + 1;
-
-		// Centro de Gravidade
-		blobs[i].xc = sumx / MAX(blobs[i].area, 1);
-		blobs[i].yc = sumy / MAX(blobs[i].area, 1);
+	for (i = 0; i < nblobs; i++)
+	{
+		// Etiquetas que não cabem na imagem de 8 bits não têm pixels
+		if ((blobs[i].label >= 0) && (blobs[i].label < 256)) vc_blob_acc_finish(&acc[blobs[i].label], &blobs[i]);
+		else vc_blob_acc_finish(&empty, &blobs[i]);
 	}
 
 	return 1;
@@ -1725,6 +2042,7 @@ int vc_gray_edge_sobel(IVC* src, IVC* dst, float th)
 
 /**
  * @brief Aplica um filtro de média em uma imagem em escala de cinza.
+ * A margem da imagem é repetida (VC_BORDER_DEFAULT); ver vc_gray_lowpass_mean_filter_border.
  * @author lugon
  * @param src Imagem de origem em escala de cinza.
  * @param dst Imagem de destino onde o resultado do filtro será armazenado.
@@ -1733,65 +2051,12 @@ int vc_gray_edge_sobel(IVC* src, IVC* dst, float th)
  */
 int vc_gray_lowpass_mean_filter(IVC* src, IVC* dst, int kernel)
 {
-	// info source
-	unsigned char* datasrc = (unsigned char*)src->data;
-	int bytesperline_src = src->width * src->channels;
-	int channels_src = src->channels;
-
-	//info destino
-	unsigned char* datadst = (unsigned char*)dst->data;
-	int bytesperline_dst = dst->width * dst->channels;
-	int channels_dst = dst->channels;
-
-	// medidas
-	int width = src->width;
-	int height = src->height;
-
-	//auxiliares gerais
-	int x, y, x2, y2, ksize;
-	long int pos_src, pos_dst, pos_src2, soma = 0;
-	float media;
-
-	//verificação de erros
-	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
-	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
-	if ((src->channels != 1) || (dst->channels != 1)) return 0;
-
-	/*Posições
-	* [A	B	C]
-	* [D	X	E]
-	* [F	G	H]
-	*/
-	ksize = (kernel - 1) / 2;
-	for (y = 0;y < height;y++)
-	{
-		for (x = 0;x < width; x++)
-		{
-			pos_src = y * bytesperline_src + x * channels_src;//posição da source
-			pos_dst = y * bytesperline_dst + x * channels_dst;//posição destino
-
-			for (y2 = (y - ksize); y2 <= (y + ksize);y2++)
-			{
-				for (x2 = (x - ksize); x2 <= (x + ksize);x2++)
-				{
-					if ((y2 >= 0) && (y2 < height) && (x2 >= 0) && (x2 < width))
-					{
-						pos_src2 = y2 * bytesperline_src + x2 * channels_src;//posição da source
-						soma += datasrc[pos_src2];
-					}
-					else datadst[pos_dst] = datasrc[pos_src];//se o kernel estiver fora da imagem
-				}
-			}
-			media = soma / (float)(kernel * kernel);//exemplo 5 por 5 = kernel x kernel
-			datadst[pos_dst] = media;
-			soma = 0;
-		}
-	}
-	return 1;
+	return vc_gray_lowpass_mean_filter_border(src, dst, kernel, VC_BORDER_DEFAULT);
 }
 
 /**
  * @brief Aplica um filtro de mediana em uma imagem em escala de cinza.
+ * A margem da imagem é repetida (VC_BORDER_DEFAULT); ver vc_gray_lowpass_median_filter_border.
  * @author lugon
  * @param src Imagem de origem em escala de cinza.
  * @param dst Imagem de destino onde o resultado do filtro será armazenado.
@@ -1800,149 +2065,22 @@ int vc_gray_lowpass_mean_filter(IVC* src, IVC* dst, int kernel)
  */
 int vc_gray_lowpass_median_filter(IVC* src, IVC* dst, int kernel)
 {
-	// info source
-	unsigned char* datasrc = (unsigned char*)src->data;
-	int bytesperline_src = src->width * src->channels;
-	int channels_src = src->channels;
+	return vc_gray_lowpass_median_filter_border(src, dst, kernel, VC_BORDER_DEFAULT);
+}
 
-	//info destino
-	unsigned char* datadst = (unsigned char*)dst->data;
-	int bytesperline_dst = dst->width * dst->channels;
-	int channels_dst = dst->channels;
-
-	// medidas
-	int width = src->width;
-	int height = src->height;
-
-	//auxiliares gerais
-	int x, y, x2, y2, ksize, npixkernel, i;
-	npixkernel = kernel * kernel;
-	long int pos_src, pos_dst, pos_src2, mediana[1000];
-
-	//verificação de erros
-	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
-	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
-	if ((src->channels != 1) || (dst->channels != 1)) return 0;
-
-	/*Posições
-	* [A	B	C]
-	* [D	X	E]
-	* [F	G	H]
-	*/
-	ksize = (kernel - 1) / 2;
-	for (y = 0;y < height;y++)
-	{
-		for (x = 0;x < width; x++)
-		{
-			pos_src = y * bytesperline_src + x * channels_src;//posição da source
-			pos_dst = y * bytesperline_dst + x * channels_dst;//posição destino
-
-			i = 0;
-			for (y2 = (y - ksize); y2 <= (y + ksize);y2++)
-			{
-				for (x2 = (x - ksize); x2 <= (x + ksize);x2++)
-				{
-					if ((y2 >= 0) && (y2 < height) && (x2 >= 0) && (x2 < width))
-					{
-						pos_src2 = y2 * bytesperline_src + x2 * channels_src;//posição da source
-						mediana[i] = datasrc[pos_src2];
-						i++;
-					}
-				}
-			}
-			// Bubble sort
-			for (i = 0; i < npixkernel - 1; i++)
-			{
-				for (int j = 0; j < npixkernel - i - 1; j++)
-				{
-					if (mediana[j] > mediana[j + 1])
-					{
-						int temp = mediana[j];
-						mediana[j] = mediana[j + 1];
-						mediana[j + 1] = temp;
-					}
-				}
-			}
-			datadst[pos_dst] = mediana[(npixkernel - 1) / 2];
-		}
-	}
-	return 1;
-}
-
-/**
- * @brief Aplica um filtro de Gauss em uma imagem em escala de cinza.
- * @author lugon
- * @param src Imagem de origem em escala de cinza.
- * @param dst Imagem de destino onde o resultado do filtro será armazenado.
- * @param kernel Tamanho do kernel a ser usado para o filtro.
- * @return int Retorna 1 se o filtro foi processado com sucesso, caso contrário retorna 0.
- */
-int vc_gray_lowpass_gaussian_filter(IVC* src, IVC* dst, int kernel)
-{
-	// info source
-	unsigned char* datasrc = (unsigned char*)src->data;
-	int bytesperline_src = src->width * src->channels;
-	int channels_src = src->channels;
-
-	// info destino
-	unsigned char* datadst = (unsigned char*)dst->data;
-	int bytesperline_dst = dst->width * dst->channels;
-	int channels_dst = dst->channels;
-
-	// medidas
-	int width = src->width;
-	int height = src->height;
-
-	// auxiliares gerais
-	int x, y, x2, y2, ksize, npixkernel;
-	float sum, weight_sum;
-	long int pos_src, pos_dst, pos_src2;
-
-	// verificação de erros
-	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
-	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
-	if ((src->channels != 1) || (dst->channels != 1)) return 0;
-
-	// Kernel Gaussiano 3x3 (sigma = 1)
-	float kernel_gauss[3][3] = {
-		{1 / 16.0, 2 / 16.0, 1 / 16.0},
-		{2 / 16.0, 4 / 16.0, 2 / 16.0},
-		{1 / 16.0, 2 / 16.0, 1 / 16.0}
-	};
-
-	ksize = 1; // 3x3 kernel has a radius of 1
-	npixkernel = (ksize * 2 + 1) * (ksize * 2 + 1);
-
-	for (y = 0; y < height; y++)
-	{
-		for (x = 0; x < width; x++)
-		{
-			pos_src = y * bytesperline_src + x * channels_src; // posição da source
-			pos_dst = y * bytesperline_dst + x * channels_dst; // posição destino
-
-			sum = 0.0;
-			weight_sum = 0.0;
-
-			for (y2 = -ksize; y2 <= ksize; y2++)
-			{
-				for (x2 = -ksize; x2 <= ksize; x2++)
-				{
-					int yk = y + y2;
-					int xk = x + x2;
-
-					if (yk >= 0 && yk < height && xk >= 0 && xk < width)
-					{
-						pos_src2 = yk * bytesperline_src + xk * channels_src; // posição da source
-						sum += datasrc[pos_src2] * kernel_gauss[y2 + ksize][x2 + ksize];
-						weight_sum += kernel_gauss[y2 + ksize][x2 + ksize];
-					}
-				}
-			}
-			datadst[pos_dst] = (unsigned char)(sum / weight_sum);
-		}
-	}
-	return 1;
-}
+/**
+ * @brief Aplica um filtro de Gauss (pesos binomiais) em uma imagem em escala de cinza.
+ * A margem da imagem é repetida (VC_BORDER_DEFAULT); ver vc_gray_lowpass_gaussian_filter_border.
+ * @author lugon
+ * @param src Imagem de origem em escala de cinza.
+ * @param dst Imagem de destino onde o resultado do filtro será armazenado.
+ * @param kernel Tamanho do kernel, em [1, 25] (3 dá o filtro 1 2 1 / 2 4 2 / 1 2 1).
+ * @return int Retorna 1 se o filtro foi processado com sucesso, caso contrário retorna 0.
+ */
+int vc_gray_lowpass_gaussian_filter(IVC* src, IVC* dst, int kernel)
+{
+	return vc_gray_lowpass_gaussian_filter_border(src, dst, kernel, VC_BORDER_DEFAULT);
+}
 
 /**
  * @brief Desenha a caixa delimitadora de um objeto.
@@ -2019,3 +2157,4349 @@ int vc_draw_centerofgravity(IVC* srcdst, OVC* blob)
 
 	return 1;
 }
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//        FUNÇÕES: PIRÂMIDE DE IMAGENS E REGIÕES DE INTERESSE
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+/**
+ * @brief Copia uma região retangular de uma imagem para uma nova imagem.
+ * A região é limitada aos limites da imagem de origem.
+ * @author lugon
+ * @param src Imagem de origem.
+ * @param x Coluna do canto superior esquerdo da região.
+ * @param y Linha do canto superior esquerdo da região.
+ * @param width Largura da região.
+ * @param height Altura da região.
+ * @return IVC* Nova imagem com a região, ou NULL se a região é vazia ou não foi possível alocar memória.
+ */
+IVC* vc_image_crop(IVC* src, int x, int y, int width, int height)
+{
+	IVC* dst;
+	int row;
+
+	if ((src == NULL) || (src->data == NULL)) return NULL;
+
+	// Limita a região à imagem
+	if (x < 0) { width += x; x = 0; }
+	if (y < 0) { height += y; y = 0; }
+	if (x + width > src->width) width = src->width - x;
+	if (y + height > src->height) height = src->height - y;
+	if ((width <= 0) || (height <= 0)) return NULL;
+
+	dst = vc_image_new(width, height, src->channels, src->levels);
+	if (dst == NULL) return NULL;
+
+	for (row = 0; row < height; row++)
+	{
+		memcpy(dst->data + row * dst->bytesperline, src->data + (y + row) * src->bytesperline + x * src->channels, dst->bytesperline);
+	}
+
+	return dst;
+}
+
+/**
+ * @brief Reduz uma imagem para metade da resolução (em vírgula fixa).
+ * Cada linha de destino é calculada em duas fases: uma soma vertical das linhas de origem para um buffer
+ * de 16 bits (SSE2) e uma soma horizontal dos pares/quádruplos de colunas.
+ * @author lugon
+ * @param src Imagem de origem (1 ou 3 canais).
+ * @param dst Imagem de destino, com (src->width / 2) x (src->height / 2) e os mesmos canais.
+ * @param gaussian 0 para média de área 2x2; 1 para o filtro binomial 4x4 [1 3 3 1] (aproximação gaussiana).
+ * @return int Retorna 1 se a redução foi bem-sucedida, 0 caso contrário.
+ */
+static int vc_pyramid_down_impl(IVC* src, IVC* dst, int gaussian)
+{
+	unsigned char* datadst = (unsigned char*)dst->data;
+	int channels = src->channels;
+	int width = dst->width;
+	int height = dst->height;
+	int rowlen = src->width * channels;
+	int x, y, c, i, xa, xd;
+	const unsigned char *ra, *rb, *rc, *rd;
+	unsigned short* vsum;
+	unsigned char* out;
+
+	// Verificação de erros
+	if ((src->width < 2) || (src->height < 2) || (src->data == NULL) || (dst->data == NULL)) return 0;
+	if ((dst->width != src->width / 2) || (dst->height != src->height / 2)) return 0;
+	if (src->channels != dst->channels) return 0;
+
+	vsum = (unsigned short*)malloc(rowlen * sizeof(unsigned short));
+	if (vsum == NULL) return 0;
+
+	for (y = 0; y < height; y++)
+	{
+		// Linhas de origem: 2y e 2y+1 (área) ou 2y-1 .. 2y+2, com as bordas replicadas (gaussiana)
+		rb = src->data + (2 * y) * src->bytesperline;
+		rc = rb + src->bytesperline;
+		ra = (y > 0) ? rb - src->bytesperline : rb;
+		rd = (2 * y + 2 < src->height) ? rc + src->bytesperline : rc;
+		out = datadst + y * dst->bytesperline;
+
+		// Soma vertical: b + c (máx. 510) ou a + 3(b + c) + d (máx. 2040)
+		i = 0;
+#ifdef VC_SSE2
+		{
+			const __m128i zero = _mm_setzero_si128();
+
+			for (; i + 16 <= rowlen; i += 16)
+			{
+				__m128i b = _mm_loadu_si128((const __m128i*)(rb + i));
+				__m128i cc = _mm_loadu_si128((const __m128i*)(rc + i));
+				__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(cc, zero));
+				__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(cc, zero));
+
+				if (gaussian)
+				{
+					__m128i a = _mm_loadu_si128((const __m128i*)(ra + i));
+					__m128i d = _mm_loadu_si128((const __m128i*)(rd + i));
+
+					lo = _mm_add_epi16(_mm_add_epi16(lo, _mm_add_epi16(lo, lo)), _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(d, zero)));
+					hi = _mm_add_epi16(_mm_add_epi16(hi, _mm_add_epi16(hi, hi)), _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(d, zero)));
+				}
+
+				_mm_storeu_si128((__m128i*)(vsum + i), lo);
+				_mm_storeu_si128((__m128i*)(vsum + i + 8), hi);
+			}
+		}
+#endif
+		for (; i < rowlen; i++)
+		{
+			if (gaussian) vsum[i] = (unsigned short)(ra[i] + 3 * (rb[i] + rc[i]) + rd[i]);
+			else vsum[i] = (unsigned short)(rb[i] + rc[i]);
+		}
+
+		// Soma horizontal e normalização com arredondamento
+		if (!gaussian)
+		{
+			x = 0;
+#ifdef VC_SSE2
+			if (channels == 1)
+			{
+				const __m128i ones = _mm_set1_epi16(1);
+				const __m128i two = _mm_set1_epi16(2);
+
+				for (; x + 8 <= width; x += 8)
+				{
+					__m128i s0 = _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(vsum + 2 * x)), ones);
+					__m128i s1 = _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(vsum + 2 * x + 8)), ones);
+					__m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_packs_epi32(s0, s1), two), 2);
+
+					_mm_storel_epi64((__m128i*)(out + x), _mm_packus_epi16(sum, sum));
+				}
+			}
+#endif
+			for (; x < width; x++)
+			{
+				for (c = 0; c < channels; c++)
+				{
+					out[x * channels + c] = (unsigned char)((vsum[(2 * x) * channels + c] + vsum[(2 * x + 1) * channels + c] + 2) >> 2);
+				}
+			}
+		}
+		else
+		{
+			for (x = 0; x < width; x++)
+			{
+				xa = (x > 0) ? 2 * x - 1 : 0;
+				xd = (2 * x + 2 < src->width) ? 2 * x + 2 : 2 * x + 1;
+
+				for (c = 0; c < channels; c++)
+				{
+					out[x * channels + c] = (unsigned char)((vsum[xa * channels + c] + 3 * (vsum[(2 * x) * channels + c] + vsum[(2 * x + 1) * channels + c]) + vsum[xd * channels + c] + 32) >> 6);
+				}
+			}
+		}
+	}
+
+	free(vsum);
+
+	return 1;
+}
+
+/**
+ * @brief Reduz uma imagem para metade da resolução pela média de cada bloco 2x2 (decimação por área).
+ * @author lugon
+ * @param src Imagem de origem (1 ou 3 canais).
+ * @param dst Imagem de destino, pré-alocada com (src->width / 2) x (src->height / 2) e os mesmos canais.
+ * @return int Retorna 1 se a redução foi bem-sucedida, 0 caso contrário.
+ */
+int vc_pyramid_down(IVC* src, IVC* dst)
+{
+	return vc_pyramid_down_impl(src, dst, 0);
+}
+
+/**
+ * @brief Reduz uma imagem para metade da resolução com o filtro binomial 4x4 [1 3 3 1] (aproximação gaussiana).
+ * @author lugon
+ * @param src Imagem de origem (1 ou 3 canais).
+ * @param dst Imagem de destino, pré-alocada com (src->width / 2) x (src->height / 2) e os mesmos canais.
+ * @return int Retorna 1 se a redução foi bem-sucedida, 0 caso contrário.
+ */
+int vc_pyramid_down_gaussian(IVC* src, IVC* dst)
+{
+	return vc_pyramid_down_impl(src, dst, 1);
+}
+
+/**
+ * @brief Constrói uma pirâmide de imagens, em que cada nível tem metade da resolução do anterior.
+ * @author lugon
+ * @param src Imagem original, que é usada como nível 0 (não é copiada).
+ * @param levels Array onde são colocados os nlevels níveis; os níveis 1 .. nlevels-1 são alocados pela função.
+ * @param nlevels Número de níveis, incluindo o original, em [1, VC_PYRAMID_MAX_LEVELS].
+ * @param gaussian 0 para decimação por área (vc_pyramid_down); 1 para decimação gaussiana (vc_pyramid_down_gaussian).
+ * @return int Retorna 1 se a pirâmide foi construída, 0 caso contrário (os níveis já alocados são libertados).
+ */
+int vc_pyramid_build(IVC* src, IVC* levels[], int nlevels, int gaussian)
+{
+	int i;
+
+	if ((src == NULL) || (src->data == NULL) || (levels == NULL)) return 0;
+	if ((nlevels < 1) || (nlevels > VC_PYRAMID_MAX_LEVELS)) return 0;
+
+	levels[0] = src;
+
+	for (i = 1; i < nlevels; i++)
+	{
+		levels[i] = vc_image_new(levels[i - 1]->width / 2, levels[i - 1]->height / 2, src->channels, src->levels);
+
+		if ((levels[i] == NULL) || !vc_pyramid_down_impl(levels[i - 1], levels[i], gaussian))
+		{
+			vc_pyramid_free(levels, i + 1);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * @brief Liberta os níveis de uma pirâmide criados por vc_pyramid_build (o nível 0 não é libertado).
+ * @author lugon
+ * @param levels Array com os níveis da pirâmide.
+ * @param nlevels Número de níveis.
+ */
+void vc_pyramid_free(IVC* levels[], int nlevels)
+{
+	int i;
+
+	for (i = 1; i < nlevels; i++)
+	{
+		levels[i] = vc_image_free(levels[i]);
+	}
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  FUNÇÕES: OPERAÇÕES PONTUAIS COMPOSTAS NUMA TABELA DE CONSULTA
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Uma cadeia de operações pontuais (negativo, threshold, equalização, ...) é composta numa única
+// tabela de 256 entradas: cada vc_lut_* aplica a sua operação à saída da cadeia construída até aí.
+// A imagem é depois percorrida uma só vez por vc_gray_apply_lut().
+
+/**
+ * @brief Inicializa uma tabela de consulta com a identidade (cadeia vazia).
+ * @author lugon
+ * @param lut Tabela a inicializar.
+ */
+void vc_lut_identity(LVC* lut)
+{
+	int i;
+
+	for (i = 0; i < 256; i++) lut->table[i] = (unsigned char)i;
+}
+
+/**
+ * @brief Acrescenta à cadeia as operações de outra tabela (lut = next(lut)).
+ * @author lugon
+ * @param lut Cadeia a estender.
+ * @param next Operações a aplicar depois das já existentes.
+ */
+void vc_lut_compose(LVC* lut, LVC* next)
+{
+	int i;
+
+	for (i = 0; i < 256; i++) lut->table[i] = next->table[lut->table[i]];
+}
+
+/**
+ * @brief Acrescenta à cadeia o negativo (255 - v).
+ * @author lugon
+ * @param lut Cadeia a estender.
+ */
+void vc_lut_negative(LVC* lut)
+{
+	int i;
+
+	for (i = 0; i < 256; i++) lut->table[i] = (unsigned char)(255 - lut->table[i]);
+}
+
+/**
+ * @brief Acrescenta à cadeia uma binarização (v < threshold -> 0, caso contrário 255).
+ * @author lugon
+ * @param lut Cadeia a estender.
+ * @param threshold Valor de threshold.
+ */
+void vc_lut_threshold(LVC* lut, int threshold)
+{
+	int i;
+
+	for (i = 0; i < 256; i++) lut->table[i] = (lut->table[i] < threshold) ? 0 : 255;
+}
+
+/**
+ * @brief Acrescenta à cadeia o negativo binário (0 -> 255, restantes -> 0).
+ * @author lugon
+ * @param lut Cadeia a estender.
+ */
+void vc_lut_binary_negative(LVC* lut)
+{
+	int i;
+
+	for (i = 0; i < 256; i++) lut->table[i] = (lut->table[i] == 0) ? 255 : 0;
+}
+
+/**
+ * @brief Acrescenta à cadeia a equalização de histograma.
+ * O histograma da saída da cadeia é obtido a partir do histograma de src e da própria tabela,
+ * sem percorrer imagens intermédias.
+ * @author lugon
+ * @param lut Cadeia a estender.
+ * @param src Imagem em escala de cinza a que a cadeia vai ser aplicada.
+ * @return int Retorna 1 se a equalização foi acrescentada, 0 se houve um erro.
+ */
+int vc_lut_equalization(LVC* lut, IVC* src)
+{
+	int hist[256];
+
+	if (!vc_gray_histogram(src, hist)) return 0;
+
+	return vc_lut_equalization_histogram(lut, hist);
+}
+
+/**
+ * @brief Acrescenta à cadeia a equalização de histograma, a partir de um histograma já calculado.
+ * Permite reutilizar o histograma de vc_gray_histogram() (por exemplo, também usado para o threshold).
+ * @author lugon
+ * @param lut Cadeia a estender.
+ * @param hist Histograma da imagem a que a cadeia vai ser aplicada.
+ * @return int Retorna 1 se a equalização foi acrescentada, 0 se o histograma é vazio.
+ */
+int vc_lut_equalization_histogram(LVC* lut, int hist[256])
+{
+	int histout[256] = { 0 };
+	int i, total = 0;	// Total de pixels
+	float pdf[256], min = 256, cdf[256], v;
+	unsigned char eq[256];
+
+	// Histograma da saída da cadeia, através da tabela
+	for (i = 0; i < 256; i++)
+	{
+		histout[lut->table[i]] += hist[i];
+		total += hist[i];
+	}
+	if (total <= 0) return 0;
+
+	for (i = 0; i < 256; i++)
+	{
+		pdf[i] = (float)histout[i] / total;
+		if ((pdf[i] < min) && (pdf[i] != 0)) min = pdf[i];	// Mínimo do pdf
+	}
+
+	for (i = 0; i < 256; i++)
+	{
+		if (i != 0) cdf[i] = cdf[i - 1] + pdf[i];	// Acumulada
+		else cdf[0] = pdf[0];
+	}
+
+	// Imagem constante: não há nada a equalizar
+	if (min >= 1.0f)
+	{
+		return 1;
+	}
+
+	for (i = 0; i < 256; i++)
+	{
+		// Níveis ausentes abaixo do primeiro bin não vazio dariam um valor negativo (não chegam à imagem)
+		v = ((cdf[i] - min) / (1 - min)) * (255 - 1);
+		eq[i] = (unsigned char)((v > 0) ? v : 0);
+	}
+
+	for (i = 0; i < 256; i++) lut->table[i] = eq[lut->table[i]];
+
+	return 1;
+}
+
+/**
+ * @brief Aplica uma tabela de consulta a uma imagem em escala de cinza, numa só passagem.
+ * Com SSSE3/AVX2 cada bloco de 16/32 pixels é resolvido por 16 consultas de 16 entradas (pshufb),
+ * uma por cada nibble alto possível.
+ * @author lugon
+ * @param src Imagem de origem em escala de cinza.
+ * @param dst Imagem de destino em escala de cinza (pode ser a própria src).
+ * @param lut Tabela a aplicar.
+ * @return int Retorna 1 se a tabela foi aplicada com sucesso, 0 se houve um erro, como dimensões inválidas ou formato de cor incorreto.
+ */
+int vc_gray_apply_lut(IVC* src, IVC* dst, LVC* lut)
+{
+	unsigned char* datasrc = (unsigned char*)src->data;
+	unsigned char* datadst = (unsigned char*)dst->data;
+	const unsigned char* table = lut->table;
+	long int i = 0, size;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL) || (dst->data == NULL)) return 0;
+	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
+	if ((src->channels != 1) || (dst->channels != 1)) return 0;
+
+	size = (long int)src->width * src->height;
+
+	// Para o bloco k (entradas 16k .. 16k+15): (v xor 16k) fica em [0,15] só nos pixels desse bloco;
+	// somando 0x70 com saturação, os restantes passam a ter o bit 7 ativo e o pshufb devolve 0
+#if defined(VC_AVX2)
+	{
+		__m256i t[16];
+		const __m256i bias = _mm256_set1_epi8(0x70);
+		int k;
+
+		for (k = 0; k < 16; k++) t[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(table + 16 * k)));
+
+		for (; i + 32 <= size; i += 32)
+		{
+			__m256i v = _mm256_loadu_si256((const __m256i*)(datasrc + i));
+			__m256i r = _mm256_setzero_si256();
+
+			for (k = 0; k < 16; k++)
+			{
+				__m256i idx = _mm256_adds_epu8(_mm256_xor_si256(v, _mm256_set1_epi8((char)(k << 4))), bias);
+				r = _mm256_or_si256(r, _mm256_shuffle_epi8(t[k], idx));
+			}
+
+			_mm256_storeu_si256((__m256i*)(datadst + i), r);
+		}
+	}
+#elif defined(VC_SSSE3)
+	{
+		__m128i t[16];
+		const __m128i bias = _mm_set1_epi8(0x70);
+		int k;
+
+		for (k = 0; k < 16; k++) t[k] = _mm_loadu_si128((const __m128i*)(table + 16 * k));
+
+		for (; i + 16 <= size; i += 16)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(datasrc + i));
+			__m128i r = _mm_setzero_si128();
+
+			for (k = 0; k < 16; k++)
+			{
+				__m128i idx = _mm_adds_epu8(_mm_xor_si128(v, _mm_set1_epi8((char)(k << 4))), bias);
+				r = _mm_or_si128(r, _mm_shuffle_epi8(t[k], idx));
+			}
+
+			_mm_storeu_si128((__m128i*)(datadst + i), r);
+		}
+	}
+#endif
+
+	for (; i < size; i++)
+	{
+		datadst[i] = table[datasrc[i]];
+	}
+
+	return 1;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//         FUNÇÕES: HISTOGRAMA E THRESHOLD AUTOMÁTICO
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// O histograma é calculado numa única passagem e partilhado pelos métodos de threshold, pela
+// equalização e pelo desenho do histograma. A seleção do threshold só percorre as 256 entradas.
+// Os thresholds devolvidos seguem a convenção de vc_gray_to_binary: v < threshold -> 0.
+
+/**
+ * @brief Calcula o histograma de uma imagem em escala de cinza numa única passagem.
+ * São usados quatro sub-histogramas intercalados, para que pixels vizinhos iguais não
+ * serializem os incrementos na mesma posição de memória.
+ * @author lugon
+ * @param src Imagem em escala de cinza.
+ * @param hist Histograma de saída (256 entradas).
+ * @return int Retorna 1 se o histograma foi calculado, 0 se houve um erro.
+ */
+int vc_gray_histogram(IVC* src, int hist[256])
+{
+	unsigned char* datasrc = (unsigned char*)src->data;
+	int sub[4][256] = { { 0 } };
+	long int i, size;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL) || (hist == NULL)) return 0;
+	if (src->channels != 1) return 0;
+
+	size = (long int)src->width * src->height;
+
+	for (i = 0; i + 4 <= size; i += 4)
+	{
+		sub[0][datasrc[i]]++;
+		sub[1][datasrc[i + 1]]++;
+		sub[2][datasrc[i + 2]]++;
+		sub[3][datasrc[i + 3]]++;
+	}
+	for (; i < size; i++) sub[0][datasrc[i]]++;
+
+	for (i = 0; i < 256; i++)
+	{
+		hist[i] = sub[0][i] + sub[1][i] + sub[2][i] + sub[3][i];
+	}
+
+	return 1;
+}
+
+/**
+ * @brief Threshold pela média global dos níveis.
+ * @author lugon
+ * @param hist Histograma da imagem.
+ * @return int Threshold (primeiro nível inteiro não inferior à média).
+ */
+int vc_histogram_threshold_mean(int hist[256])
+{
+	long long sum = 0, total = 0;
+	float media;
+	int i;
+
+	for (i = 0; i < 256; i++)
+	{
+		sum += (long long)i * hist[i];
+		total += hist[i];
+	}
+	if (total == 0) return 0;
+
+	media = (float)sum / total;
+
+	// Menor nível inteiro v com v >= media (v < media -> 0)
+	i = (int)media;
+	if ((float)i < media) i++;
+
+	return i;
+}
+
+/**
+ * @brief Threshold de Otsu: maximiza a variância entre as duas classes.
+ * @author lugon
+ * @param hist Histograma da imagem.
+ * @return int Threshold t (as classes são [0, t-1] e [t, 255]).
+ */
+int vc_histogram_threshold_otsu(int hist[256])
+{
+	double sum = 0.0, sum0 = 0.0, w0 = 0.0, w1, total = 0.0;
+	double m0, m1, between, best = -1.0;
+	int i, t = 0;
+
+	for (i = 0; i < 256; i++)
+	{
+		sum += (double)i * hist[i];
+		total += hist[i];
+	}
+	if (total == 0.0) return 0;
+
+	for (i = 0; i < 256; i++)
+	{
+		w0 += hist[i];
+		if (w0 == 0.0) continue;
+		w1 = total - w0;
+		if (w1 == 0.0) break;
+
+		sum0 += (double)i * hist[i];
+		m0 = sum0 / w0;
+		m1 = (sum - sum0) / w1;
+
+		between = w0 * w1 * (m0 - m1) * (m0 - m1);
+		if (between > best)
+		{
+			best = between;
+			t = i;
+		}
+	}
+
+	// A classe 0 inclui o nível t
+	return t + 1;
+}
+
+/**
+ * @brief Threshold pelo método do triângulo (Zack): nível mais afastado da reta entre o pico
+ * do histograma e a extremidade mais distante.
+ * @author lugon
+ * @param hist Histograma da imagem.
+ * @return int Threshold t (as classes são [0, t-1] e [t, 255]).
+ */
+int vc_histogram_threshold_triangle(int hist[256])
+{
+	int h[256];
+	int i, left = 0, right = 255, peak = 0, flip = 0, t;
+	long long a, b, dist, tmp;
+
+	for (i = 0; i < 256; i++) h[i] = hist[i];
+
+	// Extremos não nulos do histograma (com uma posição de margem) e pico
+	while ((left < 255) && (h[left] == 0)) left++;
+	while ((right > 0) && (h[right] == 0)) right--;
+	if (left > right) return 0;	// Histograma vazio
+	if (left > 0) left--;
+	if (right < 255) right++;
+
+	for (i = 0; i < 256; i++)
+	{
+		if (h[i] > h[peak]) peak = i;
+	}
+
+	// A procura é feita sempre do lado esquerdo do pico: se a cauda maior for a direita, inverte o histograma
+	if (peak - left < right - peak)
+	{
+		flip = 1;
+		for (i = 0; i < 128; i++)
+		{
+			tmp = h[i];
+			h[i] = h[255 - i];
+			h[255 - i] = (int)tmp;
+		}
+		left = 255 - right;
+		peak = 255 - peak;
+	}
+
+	// Distância (não normalizada) de (i, h[i]) à reta entre (left, 0) e (peak, h[peak])
+	t = left;
+	a = h[peak];
+	b = left - peak;
+	dist = 0;
+	for (i = left + 1; i <= peak; i++)
+	{
+		tmp = a * i + b * h[i];
+		if (tmp > dist)
+		{
+			dist = tmp;
+			t = i;
+		}
+	}
+	t--;
+
+	if (flip) t = 255 - t;
+	if (t > 255) t = 255;
+
+	// A classe 0 inclui o nível t
+	return t + 1;
+}
+
+/**
+ * @brief Otsu multinível: escolhe nthresholds thresholds que maximizam a variância entre classes.
+ * Programação dinâmica sobre somas acumuladas do histograma: cada classe acrescentada testa todos os
+ * pares (início, fim) de níveis, pelo que o custo é O(nthresholds * 256^2), cerca de 33 mil termos por
+ * threshold, independente do tamanho da imagem.
+ * @author lugon
+ * @param hist Histograma da imagem.
+ * @param thresholds Array de saída com os nthresholds thresholds, por ordem crescente.
+ * @param nthresholds Número de thresholds, em [1, VC_MULTI_OTSU_MAX].
+ * @return int Retorna 1 se os thresholds foram calculados, 0 se houve um erro.
+ */
+int vc_histogram_threshold_multi_otsu(int hist[256], int thresholds[], int nthresholds)
+{
+	double p[257], s[257];	// Somas acumuladas de h[i] e de i*h[i] em [0, j)
+	double score[VC_MULTI_OTSU_MAX + 2][257], w, m, v;
+	short from[VC_MULTI_OTSU_MAX + 2][257];
+	int c, i, j, nclasses = nthresholds + 1;
+
+	if ((thresholds == NULL) || (nthresholds < 1) || (nthresholds > VC_MULTI_OTSU_MAX)) return 0;
+
+	p[0] = s[0] = 0.0;
+	for (i = 0; i < 256; i++)
+	{
+		p[i + 1] = p[i] + hist[i];
+		s[i + 1] = s[i] + (double)i * hist[i];
+	}
+	if (p[256] == 0.0) return 0;
+
+	// score[c][j]: máximo de soma(S^2 / W) com c classes a cobrir os níveis [0, j)
+	for (j = 0; j <= 256; j++)
+	{
+		w = p[j];
+		score[1][j] = (w > 0.0) ? (s[j] * s[j]) / w : 0.0;
+		from[1][j] = 0;
+	}
+	for (c = 2; c <= nclasses; c++)
+	{
+		for (j = c; j <= 256; j++)
+		{
+			score[c][j] = -1.0;
+			from[c][j] = (short)(c - 1);
+			for (i = c - 1; i < j; i++)
+			{
+				w = p[j] - p[i];
+				m = s[j] - s[i];
+				v = score[c - 1][i] + ((w > 0.0) ? (m * m) / w : 0.0);
+				if (v > score[c][j])
+				{
+					score[c][j] = v;
+					from[c][j] = (short)i;
+				}
+			}
+		}
+	}
+
+	// Recupera as fronteiras entre classes (primeiro nível de cada classe seguinte)
+	for (c = nclasses, j = 256; c > 1; c--)
+	{
+		j = from[c][j];
+		thresholds[c - 2] = j;
+	}
+
+	return 1;
+}
+
+/**
+ * @brief Binariza uma imagem em escala de cinza com um threshold escolhido automaticamente.
+ * Custa uma passagem para o histograma e uma passagem pela tabela de consulta.
+ * @author lugon
+ * @param src Imagem de origem em escala de cinza.
+ * @param dst Imagem binária de destino (0/255).
+ * @param method VC_THRESHOLD_MEAN, VC_THRESHOLD_OTSU ou VC_THRESHOLD_TRIANGLE.
+ * @param threshold Se não for NULL, recebe o threshold usado.
+ * @return int Retorna 1 se a conversão foi bem-sucedida, 0 se houve um erro, como dimensões inválidas ou formato de cor incorreto.
+ */
+int vc_gray_to_binary_auto(IVC* src, IVC* dst, int method, int* threshold)
+{
+	int hist[256], t;
+	LVC lut;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
+	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
+	if ((src->channels != 1) || (dst->channels != 1)) return 0;
+
+	if (!vc_gray_histogram(src, hist)) return 0;
+
+	switch (method)
+	{
+	case VC_THRESHOLD_MEAN: t = vc_histogram_threshold_mean(hist); break;
+	case VC_THRESHOLD_OTSU: t = vc_histogram_threshold_otsu(hist); break;
+	case VC_THRESHOLD_TRIANGLE: t = vc_histogram_threshold_triangle(hist); break;
+	default: return 0;
+	}
+
+	if (threshold != NULL) *threshold = t;
+
+	vc_lut_identity(&lut);
+	vc_lut_threshold(&lut, t);
+
+	return vc_gray_apply_lut(src, dst, &lut);
+}
+
+/**
+ * @brief Quantiza uma imagem em escala de cinza em nthresholds+1 classes pelo Otsu multinível.
+ * A classe c é escrita como c * 255 / nthresholds.
+ * @author lugon
+ * @param src Imagem de origem em escala de cinza.
+ * @param dst Imagem de destino em escala de cinza.
+ * @param thresholds Se não for NULL, recebe os thresholds usados.
+ * @param nthresholds Número de thresholds, em [1, VC_MULTI_OTSU_MAX].
+ * @return int Retorna 1 se a conversão foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_gray_to_multilevel_otsu(IVC* src, IVC* dst, int thresholds[], int nthresholds)
+{
+	int hist[256], t[VC_MULTI_OTSU_MAX];
+	int i, c;
+	LVC lut;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
+	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
+	if ((src->channels != 1) || (dst->channels != 1)) return 0;
+
+	if (!vc_gray_histogram(src, hist)) return 0;
+	if (!vc_histogram_threshold_multi_otsu(hist, t, nthresholds)) return 0;
+
+	for (i = 0, c = 0; i < 256; i++)
+	{
+		while ((c < nthresholds) && (i >= t[c])) c++;
+		lut.table[i] = (unsigned char)(c * 255 / nthresholds);
+	}
+
+	if (thresholds != NULL)
+	{
+		for (c = 0; c < nthresholds; c++) thresholds[c] = t[c];
+	}
+
+	return vc_gray_apply_lut(src, dst, &lut);
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//     FUNÇÕES: FILTROS DE MÍNIMO/MÁXIMO (VAN HERK/GIL-WERMAN)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// O mínimo/máximo numa janela k x k é separável: primeiro em cada linha, depois em cada coluna.
+// Em 1D, a sequência é dividida em blocos de k elementos; para cada bloco calcula-se o acumulado
+// a partir do início (g) e a partir do fim (h). Qualquer janela de k elementos cobre o fim de um
+// bloco e o início do seguinte, pelo que o resultado é OP(h[i], g[i + k - 1]): três comparações
+// por elemento, qualquer que seja k. Fora da imagem usa-se o elemento neutro (255 para o mínimo,
+// 0 para o máximo), o que equivale a ignorar os vizinhos fora dos limites.
+
+// d[j] = MIN(a[j], b[j]) e d[j] = MAX(a[j], b[j]) para j em [0, n); d pode ser a ou b
+static void vc_bytes_min(unsigned char* d, unsigned char* a, unsigned char* b, int n)
+{
+	int j = 0;
+
+#if defined(VC_AVX2)
+	for (; j + 32 <= n; j += 32) _mm256_storeu_si256((__m256i*)(d + j), _mm256_min_epu8(_mm256_loadu_si256((__m256i*)(a + j)), _mm256_loadu_si256((__m256i*)(b + j))));
+#endif
+#if defined(VC_SSE2)
+	for (; j + 16 <= n; j += 16) _mm_storeu_si128((__m128i*)(d + j), _mm_min_epu8(_mm_loadu_si128((__m128i*)(a + j)), _mm_loadu_si128((__m128i*)(b + j))));
+#endif
+	for (; j < n; j++) d[j] = MIN(a[j], b[j]);
+}
+
+static void vc_bytes_max(unsigned char* d, unsigned char* a, unsigned char* b, int n)
+{
+	int j = 0;
+
+#if defined(VC_AVX2)
+	for (; j + 32 <= n; j += 32) _mm256_storeu_si256((__m256i*)(d + j), _mm256_max_epu8(_mm256_loadu_si256((__m256i*)(a + j)), _mm256_loadu_si256((__m256i*)(b + j))));
+#endif
+#if defined(VC_SSE2)
+	for (; j + 16 <= n; j += 16) _mm_storeu_si128((__m128i*)(d + j), _mm_max_epu8(_mm_loadu_si128((__m128i*)(a + j)), _mm_loadu_si128((__m128i*)(b + j))));
+#endif
+	for (; j < n; j++) d[j] = MAX(a[j], b[j]);
+}
+
+// dst (height x width) = transposta de src (width x height), por blocos de 16 x 16 para aproveitar a cache
+static void vc_bytes_transpose(unsigned char* src, int width, int height, unsigned char* dst)
+{
+	int x0, y0, x, y;
+
+	for (y0 = 0; y0 < height; y0 += 16)
+	{
+		for (x0 = 0; x0 < width; x0 += 16)
+		{
+			for (x = x0; x < MIN(x0 + 16, width); x++)
+			{
+				for (y = y0; y < MIN(y0 + 16, height); y++) dst[(long int)x * height + y] = src[(long int)y * width + x];
+			}
+		}
+	}
+}
+
+// Processa n elementos de 'lanes' sequências independentes guardadas lado a lado
+// (elemento i da sequência j em src[i * lanes + j]), pelo que cada passo é uma operação
+// vetorial sobre 'lanes' bytes. g e h têm (n + 4r) * lanes bytes.
+#define VC_VHGW_IMPL(name, VOP, NEUTRAL) \
+static void name(unsigned char* src, int n, int lanes, int r, unsigned char* dst, unsigned char* g, unsigned char* h) \
+{ \
+	int k = 2 * r + 1; \
+	int len = ((n + 2 * r + k - 1) / k) * k; \
+	int i, s; \
+	unsigned char *gi, *hi, *fi; \
+	\
+	/* Acumulado desde o início de cada bloco */ \
+	for (i = 0; i < len; i++) \
+	{ \
+		gi = g + (long int)i * lanes; \
+		s = i - r; \
+		if ((s >= 0) && (s < n)) \
+		{ \
+			fi = src + (long int)s * lanes; \
+			if (i % k == 0) memcpy(gi, fi, lanes); \
+			else VOP(gi, gi - lanes, fi, lanes); \
+		} \
+		else if (i % k == 0) memset(gi, NEUTRAL, lanes); \
+		else memcpy(gi, gi - lanes, lanes); \
+	} \
+	\
+	/* Acumulado desde o fim de cada bloco (só são necessárias as posições 0..n-1) */ \
+	for (i = len - 1; i >= 0; i--) \
+	{ \
+		hi = h + (long int)i * lanes; \
+		s = i - r; \
+		if ((s >= 0) && (s < n)) \
+		{ \
+			fi = src + (long int)s * lanes; \
+			if (i % k == k - 1) memcpy(hi, fi, lanes); \
+			else VOP(hi, hi + lanes, fi, lanes); \
+		} \
+		else if (i % k == k - 1) memset(hi, NEUTRAL, lanes); \
+		else memcpy(hi, hi + lanes, lanes); \
+	} \
+	\
+	/* Janela [i - r, i + r] da imagem = posições [i, i + 2r] da sequência com margem */ \
+	for (i = 0; i < n; i++) \
+	{ \
+		VOP(dst + (long int)i * lanes, h + (long int)i * lanes, g + (long int)(i + 2 * r) * lanes, lanes); \
+	} \
+}
+
+VC_VHGW_IMPL(vc_vhgw_min, vc_bytes_min, 255)
+VC_VHGW_IMPL(vc_vhgw_max, vc_bytes_max, 0)
+
+/**
+ * @brief Calcula o mínimo e/ou o máximo locais numa janela kernel x kernel (van Herk/Gil-Werman).
+ * O custo por pixel é constante, independente do tamanho do kernel. Vizinhos fora da imagem são ignorados.
+ * Ignorar os vizinhos fora da imagem equivale a VC_BORDER_DEFAULT (e a VC_BORDER_REFLECT): num mínimo ou
+ * máximo, os valores repetidos ou espelhados já estão dentro da janela.
+ * @author lugon
+ * @param src Imagem de origem em escala de cinza.
+ * @param dstmin Imagem de destino com o mínimo local (pode ser NULL).
+ * @param dstmax Imagem de destino com o máximo local (pode ser NULL).
+ * @param kernel Tamanho do kernel (um kernel par comporta-se como o ímpar imediatamente inferior).
+ * @return int Retorna 1 se o filtro foi aplicado, 0 se houve um erro, como dimensões inválidas ou falta de memória.
+ */
+int vc_gray_min_max_filter(IVC* src, IVC* dstmin, IVC* dstmax, int kernel)
+{
+	IVC* dsts[2];
+	unsigned char *tmp, *tr, *g, *h;
+	int width = src->width;
+	int height = src->height;
+	int r = (kernel - 1) / 2;
+	long int size = (long int)width * height;
+	long int bufrows, bufcols, bufsize;
+	int d;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
+	if ((src->channels != 1) || (kernel < 1)) return 0;
+	if ((dstmin == NULL) && (dstmax == NULL)) return 0;
+	dsts[0] = dstmin;
+	dsts[1] = dstmax;
+	for (d = 0; d < 2; d++)
+	{
+		if (dsts[d] == NULL) continue;
+		if ((dsts[d]->width != width) || (dsts[d]->height != height) || (dsts[d]->channels != 1)) return 0;
+	}
+
+	// Buffers g e h partilhados pelas duas passagens: a horizontal precisa de (width + 4r) * height
+	// bytes e a vertical de (height + 4r) * width
+	bufrows = (long int)(width + 4 * r) * height;
+	bufcols = (long int)(height + 4 * r) * width;
+	bufsize = MAX(bufrows, bufcols);
+	tmp = (unsigned char*)malloc(size);
+	tr = (unsigned char*)malloc(size);
+	g = (unsigned char*)malloc(bufsize);
+	h = (unsigned char*)malloc(bufsize);
+	if ((tmp == NULL) || (tr == NULL) || (g == NULL) || (h == NULL))
+	{
+		free(tmp);
+		free(tr);
+		free(g);
+		free(h);
+		return 0;
+	}
+
+	// Na transposta, as linhas da imagem ficam lado a lado
+	vc_bytes_transpose(src->data, width, height, tr);
+
+	for (d = 0; d < 2; d++)
+	{
+		if (dsts[d] == NULL) continue;
+
+		// Passagem horizontal, sobre a transposta
+		if (d == 0) vc_vhgw_min(tr, width, height, r, tmp, g, h);
+		else vc_vhgw_max(tr, width, height, r, tmp, g, h);
+		vc_bytes_transpose(tmp, height, width, dsts[d]->data);
+
+		// Passagem vertical: todas as colunas em simultâneo, linha a linha (o resultado só é escrito
+		// depois de g e h estarem completos, pelo que a origem pode ser o próprio destino)
+		if (d == 0) vc_vhgw_min(dsts[d]->data, height, width, r, dsts[d]->data, g, h);
+		else vc_vhgw_max(dsts[d]->data, height, width, r, dsts[d]->data, g, h);
+	}
+
+	free(tmp);
+	free(tr);
+	free(g);
+	free(h);
+
+	return 1;
+}
+
+/**
+ * @brief Binarização local Midpoint: o pixel é fundo se for inferior a (mínimo + máximo) / 2 na
+ * janela kernel x kernel, e frente caso contrário.
+ * Na borda, o resultado é o mesmo que com VC_BORDER_DEFAULT (ver vc_gray_min_max_filter).
+ * @author lugon
+ * @param src Imagem de origem em escala de cinza.
+ * @param dst Imagem binária de destino.
+ * @param kernel Tamanho do kernel.
+ * @param foreground Valor escrito nos pixels de frente (1 ou 255); o fundo é 0.
+ * @return int Retorna 1 se a conversão foi bem-sucedida, 0 se houve um erro, como dimensões inválidas ou formato de cor incorreto.
+ */
+int vc_gray_to_binary_midpoint(IVC* src, IVC* dst, int kernel, unsigned char foreground)
+{
+	IVC *mn, *mx;
+	long int i, size;
+	int ok;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
+	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
+	if ((src->channels != 1) || (dst->channels != 1)) return 0;
+
+	mn = vc_image_new(src->width, src->height, 1, 255);
+	mx = vc_image_new(src->width, src->height, 1, 255);
+	ok = (mn != NULL) && (mx != NULL) && vc_gray_min_max_filter(src, mn, mx, kernel);
+
+	if (ok)
+	{
+		// v < (min + max) / 2  <=>  2v < min + max (sem vírgula flutuante)
+		size = (long int)src->width * src->height;
+		for (i = 0; i < size; i++)
+		{
+			dst->data[i] = (2 * src->data[i] < mn->data[i] + mx->data[i]) ? 0 : foreground;
+		}
+	}
+
+	vc_image_free(mn);
+	vc_image_free(mx);
+
+	return ok;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//       FUNÇÕES: IMAGEM INTEGRAL E THRESHOLDS ADAPTATIVOS
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// A imagem integral responde à soma (e à soma dos quadrados) de qualquer retângulo com quatro
+// acessos, o que torna a média e a variância locais independentes do tamanho da janela.
+
+/**
+ * @brief Aloca uma imagem integral para imagens de width x height pixels.
+ * @author lugon
+ * @param width Largura da imagem de origem.
+ * @param height Altura da imagem de origem.
+ * @param squared Se diferente de 0, também aloca a soma dos quadrados (necessária para a variância).
+ * @return SVC* Imagem integral alocada, ou NULL em caso de erro.
+ */
+SVC* vc_integral_new(int width, int height, int squared)
+{
+	SVC* integral;
+	size_t size;
+
+	if ((width <= 0) || (height <= 0)) return NULL;
+
+	integral = (SVC*)malloc(sizeof(SVC));
+	if (integral == NULL) return NULL;
+
+	size = (size_t)(width + 1) * (height + 1);
+	integral->width = width;
+	integral->height = height;
+	integral->sum = (unsigned int*)calloc(size, sizeof(unsigned int));
+	integral->sqsum = squared ? (unsigned long long*)calloc(size, sizeof(unsigned long long)) : NULL;
+
+	if ((integral->sum == NULL) || (squared && (integral->sqsum == NULL))) return vc_integral_free(integral);
+
+	return integral;
+}
+
+/**
+ * @brief Liberta uma imagem integral.
+ * @author lugon
+ * @param integral Imagem integral a libertar (pode ser NULL).
+ * @return SVC* Retorna sempre NULL.
+ */
+SVC* vc_integral_free(SVC* integral)
+{
+	if (integral != NULL)
+	{
+		free(integral->sum);
+		free(integral->sqsum);
+		free(integral);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Calcula a imagem integral (e a dos quadrados, se foi alocada) de uma imagem em escala de cinza.
+ * Cada linha é a soma acumulada da linha de origem mais a linha anterior da integral; com SSE2
+ * são processados 4 pixels por iteração (soma prefixa dentro do registo mais o transporte da linha).
+ * @author lugon
+ * @param src Imagem de origem em escala de cinza.
+ * @param integral Imagem integral alocada com as mesmas dimensões de src.
+ * @return int Retorna 1 se a integral foi calculada, 0 se houve um erro.
+ */
+int vc_integral_compute(IVC* src, SVC* integral)
+{
+	int width = src->width;
+	int height = src->height;
+	int stride = width + 1;
+	int x, y;
+	unsigned char* row;
+	unsigned int *s, *sa, rs;
+	unsigned long long *q, *qa, rq;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL) || (integral == NULL)) return 0;
+	if (src->channels != 1) return 0;
+	if ((integral->width != width) || (integral->height != height)) return 0;
+
+	// A linha 0 e a coluna 0 são zero (calloc); a linha y+1 guarda as somas de [0, y]
+	for (y = 0; y < height; y++)
+	{
+		row = src->data + (long int)y * width;
+		sa = integral->sum + (long int)y * stride + 1;	// Linha anterior
+		s = sa + stride;								// Linha atual
+		qa = (integral->sqsum != NULL) ? integral->sqsum + (long int)y * stride + 1 : NULL;
+		q = (qa != NULL) ? qa + stride : NULL;
+		rs = 0;
+		rq = 0;
+		x = 0;
+
+#ifdef VC_SSE2
+		{
+			__m128i zero = _mm_setzero_si128();
+			__m128i cs = _mm_setzero_si128();	// Transporte da soma (replicado nas 4 posições)
+			__m128i cq = _mm_setzero_si128();	// Transporte da soma dos quadrados (replicado nas 2 posições)
+			__m128i v, v2, lo, hi;
+			int pix;
+
+			for (; x + 4 <= width; x += 4)
+			{
+				memcpy(&pix, row + x, 4);
+				v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(pix), zero), zero);
+
+				if (q != NULL)
+				{
+					// v*v em 32 bits (madd dos pares (v, 0)), soma prefixa e alargamento a 64 bits
+					v2 = _mm_madd_epi16(v, v);
+					v2 = _mm_add_epi32(v2, _mm_slli_si128(v2, 4));
+					v2 = _mm_add_epi32(v2, _mm_slli_si128(v2, 8));
+					lo = _mm_add_epi64(_mm_unpacklo_epi32(v2, zero), cq);
+					hi = _mm_add_epi64(_mm_unpackhi_epi32(v2, zero), cq);
+					cq = _mm_unpackhi_epi64(hi, hi);
+					_mm_storeu_si128((__m128i*)(q + x), _mm_add_epi64(lo, _mm_loadu_si128((__m128i*)(qa + x))));
+					_mm_storeu_si128((__m128i*)(q + x + 2), _mm_add_epi64(hi, _mm_loadu_si128((__m128i*)(qa + x + 2))));
+				}
+
+				v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+				v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+				v = _mm_add_epi32(v, cs);
+				cs = _mm_shuffle_epi32(v, 0xFF);
+				_mm_storeu_si128((__m128i*)(s + x), _mm_add_epi32(v, _mm_loadu_si128((__m128i*)(sa + x))));
+			}
+
+			rs = (unsigned int)_mm_cvtsi128_si32(cs);
+			if (q != NULL) _mm_storel_epi64((__m128i*)&rq, cq);
+		}
+#endif
+
+		for (; x < width; x++)
+		{
+			rs += row[x];
+			s[x] = rs + sa[x];
+			if (q != NULL)
+			{
+				rq += (unsigned int)row[x] * row[x];
+				q[x] = rq + qa[x];
+			}
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * @brief Soma dos níveis no retângulo [x, x + width) x [y, y + height), em tempo constante.
+ * O retângulo tem de estar contido na imagem.
+ * @author lugon
+ * @param integral Imagem integral.
+ * @param x Coluna do canto superior esquerdo.
+ * @param y Linha do canto superior esquerdo.
+ * @param width Largura do retângulo.
+ * @param height Altura do retângulo.
+ * @return unsigned int Soma dos níveis.
+ */
+unsigned int vc_integral_sum(SVC* integral, int x, int y, int width, int height)
+{
+	int stride = integral->width + 1;
+	unsigned int* top = integral->sum + (long int)y * stride + x;
+	unsigned int* bottom = top + (long int)height * stride;
+
+	return bottom[width] - bottom[0] - top[width] + top[0];
+}
+
+/**
+ * @brief Soma dos quadrados dos níveis no retângulo [x, x + width) x [y, y + height), em tempo constante.
+ * @author lugon
+ * @param integral Imagem integral alocada com a soma dos quadrados.
+ * @param x Coluna do canto superior esquerdo.
+ * @param y Linha do canto superior esquerdo.
+ * @param width Largura do retângulo.
+ * @param height Altura do retângulo.
+ * @return unsigned long long Soma dos quadrados, ou 0 se a integral não tem a soma dos quadrados.
+ */
+unsigned long long vc_integral_sqsum(SVC* integral, int x, int y, int width, int height)
+{
+	int stride = integral->width + 1;
+	unsigned long long *top, *bottom;
+
+	if (integral->sqsum == NULL) return 0;
+
+	top = integral->sqsum + (long int)y * stride + x;
+	bottom = top + (long int)height * stride;
+
+	return bottom[width] - bottom[0] - top[width] + top[0];
+}
+
+/**
+ * @brief Média dos níveis no retângulo [x, x + width) x [y, y + height).
+ * @author lugon
+ * @param integral Imagem integral.
+ * @param x Coluna do canto superior esquerdo.
+ * @param y Linha do canto superior esquerdo.
+ * @param width Largura do retângulo.
+ * @param height Altura do retângulo.
+ * @return float Média, ou 0 se o retângulo é vazio.
+ */
+float vc_integral_mean(SVC* integral, int x, int y, int width, int height)
+{
+	if ((width <= 0) || (height <= 0)) return 0.0f;
+
+	return (float)vc_integral_sum(integral, x, y, width, height) / ((float)width * height);
+}
+
+/**
+ * @brief Variância dos níveis no retângulo [x, x + width) x [y, y + height).
+ * @author lugon
+ * @param integral Imagem integral alocada com a soma dos quadrados.
+ * @param x Coluna do canto superior esquerdo.
+ * @param y Linha do canto superior esquerdo.
+ * @param width Largura do retângulo.
+ * @param height Altura do retângulo.
+ * @return float Variância, ou 0 se o retângulo é vazio.
+ */
+float vc_integral_variance(SVC* integral, int x, int y, int width, int height)
+{
+	double n, mean, var;
+
+	if ((width <= 0) || (height <= 0) || (integral->sqsum == NULL)) return 0.0f;
+
+	n = (double)width * height;
+	mean = vc_integral_sum(integral, x, y, width, height) / n;
+	var = vc_integral_sqsum(integral, x, y, width, height) / n - mean * mean;
+
+	return (var > 0.0) ? (float)var : 0.0f;
+}
+
+// Parâmetros dos thresholds adaptativos
+#define VC_ADAPTIVE_NIBLACK	0
+#define VC_ADAPTIVE_SAUVOLA	1
+
+// Binarização com threshold local T = f(média, desvio padrão) numa janela kernel x kernel,
+// cortada nos limites da imagem: v < T -> 0, caso contrário 255
+static int vc_gray_to_binary_adaptive(IVC* src, IVC* dst, int kernel, int method, double k, double r)
+{
+	int width = src->width;
+	int height = src->height;
+	int x, y, x0, y0, x1, y1, ksize;
+	double n, mean, var, sd, t;
+	SVC* integral;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
+	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
+	if ((src->channels != 1) || (dst->channels != 1) || (kernel < 1)) return 0;
+
+	integral = vc_integral_new(width, height, 1);
+	if (integral == NULL) return 0;
+	vc_integral_compute(src, integral);
+
+	ksize = (kernel - 1) / 2;
+	for (y = 0; y < height; y++)
+	{
+		y0 = MAX(y - ksize, 0);
+		y1 = MIN(y + ksize, height - 1) + 1;
+		for (x = 0; x < width; x++)
+		{
+			x0 = MAX(x - ksize, 0);
+			x1 = MIN(x + ksize, width - 1) + 1;
+
+			n = (double)(x1 - x0) * (y1 - y0);
+			mean = vc_integral_sum(integral, x0, y0, x1 - x0, y1 - y0) / n;
+			var = vc_integral_sqsum(integral, x0, y0, x1 - x0, y1 - y0) / n - mean * mean;
+			sd = (var > 0.0) ? sqrt(var) : 0.0;
+
+			if (method == VC_ADAPTIVE_NIBLACK) t = mean + k * sd;
+			else t = mean * (1.0 + k * (sd / r - 1.0));
+
+			dst->data[(long int)y * width + x] = (src->data[(long int)y * width + x] < t) ? 0 : 255;
+		}
+	}
+
+	vc_integral_free(integral);
+
+	return 1;
+}
+
+/**
+ * @brief Binarização adaptativa de Niblack: T = média + k * desvio padrão na janela kernel x kernel.
+ * @author lugon
+ * @param src Imagem de origem em escala de cinza.
+ * @param dst Imagem binária de destino (0/255).
+ * @param kernel Tamanho da janela (qualquer tamanho, com o mesmo custo por pixel).
+ * @param k Peso do desvio padrão (tipicamente -0.2).
+ * @return int Retorna 1 se a conversão foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_gray_to_binary_niblack(IVC* src, IVC* dst, int kernel, float k)
+{
+	return vc_gray_to_binary_adaptive(src, dst, kernel, VC_ADAPTIVE_NIBLACK, k, 1.0);
+}
+
+/**
+ * @brief Binarização adaptativa de Sauvola: T = média * (1 + k * (desvio padrão / r - 1)).
+ * @author lugon
+ * @param src Imagem de origem em escala de cinza.
+ * @param dst Imagem binária de destino (0/255).
+ * @param kernel Tamanho da janela (qualquer tamanho, com o mesmo custo por pixel).
+ * @param k Sensibilidade (tipicamente 0.5).
+ * @param r Gama dinâmica do desvio padrão (tipicamente 128).
+ * @return int Retorna 1 se a conversão foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_gray_to_binary_sauvola(IVC* src, IVC* dst, int kernel, float k, float r)
+{
+	if (r <= 0.0f) return 0;
+
+	return vc_gray_to_binary_adaptive(src, dst, kernel, VC_ADAPTIVE_SAUVOLA, k, r);
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  FUNÇÕES: SEGMENTAÇÃO HSV MULTI-INTERVALO (UM BIT POR INTERVALO)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Até VC_HSV_MAX_RANGES intervalos são avaliados numa única passagem: cada pixel da imagem de
+// destino guarda no bit r se pertence ao intervalo r. As contagens por intervalo são obtidas do
+// histograma das máscaras, sem testar bit a bit em cada pixel.
+
+// Constrói as tabelas por canal (bit r = intervalo r) para uma escala de Hue com máximo hmax
+static int vc_hsv_tables_build(RVC ranges[], int nranges, int hmax, unsigned char th[256], unsigned char ts[256], unsigned char tv[256])
+{
+	int r, maxHue;
+	unsigned char bit;
+
+	if ((ranges == NULL) || (nranges < 1) || (nranges > VC_HSV_MAX_RANGES)) return 0;
+
+	memset(th, 0, 256);
+	memset(ts, 0, 256);
+	memset(tv, 0, 256);
+
+	for (r = 0; r < nranges; r++)
+	{
+		if (ranges[r].minHue > hmax) return 0;
+		maxHue = (ranges[r].maxHue > hmax) ? hmax : ranges[r].maxHue;
+		bit = (unsigned char)(1 << r);
+
+		// Com volta pelo 0, o intervalo de Hue termina no limite da escala
+		if (ranges[r].minHue > maxHue)
+		{
+			vc_hsv_table_range(th, ranges[r].minHue, hmax, bit);
+			vc_hsv_table_range(th, 0, maxHue, bit);
+		}
+		else vc_hsv_table_range(th, ranges[r].minHue, maxHue, bit);
+		vc_hsv_table_range(ts, ranges[r].minSaturation, ranges[r].maxSaturation, bit);
+		vc_hsv_table_range(tv, ranges[r].minValue, ranges[r].maxValue, bit);
+	}
+
+	return 1;
+}
+
+/**
+ * @brief Gera uma função de segmentação HSV multi-intervalo para uma escala de Hue fixa (HMAX).
+ * @author lugon
+ */
+#define VC_HSV_SEGMENTATION_RANGES_IMPL(name, HMAX) \
+int name(IVC* src, IVC* dst, RVC ranges[], int nranges, int counts[]) \
+{ \
+	unsigned char th[256], ts[256], tv[256]; \
+	int hist[256]; \
+	int r, m; \
+ \
+	/* Verificação de erros */ \
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL) || (dst->data == NULL)) return 0; \
+	if ((src->width != dst->width) || (src->height != dst->height)) return 0; \
+	if ((src->channels != 3) || (dst->channels != 1)) return 0; \
+	if (!vc_hsv_tables_build(ranges, nranges, (HMAX), th, ts, tv)) return 0; \
+ \
+	vc_hsv_mask_run(src->data, dst->data, (long int)src->width * src->height, th, ts, tv); \
+ \
+	if (counts != NULL) \
+	{ \
+		vc_gray_histogram(dst, hist); \
+		for (r = 0; r < nranges; r++) \
+		{ \
+			counts[r] = 0; \
+			for (m = 0; m < 256; m++) \
+			{ \
+				if (m & (1 << r)) counts[r] += hist[m]; \
+			} \
+		} \
+	} \
+ \
+	return 1; \
+}
+
+/**
+ * @brief Segmenta uma imagem HSV (Hue em [0,255]) com vários intervalos numa única passagem.
+ * @author lugon
+ * @param src Imagem de entrada em HSV.
+ * @param dst Imagem de saída com 1 canal: o bit r de cada pixel indica se pertence ao intervalo r.
+ * @param ranges Intervalos a testar; minHue > maxHue define um intervalo de Hue que dá a volta pelo 0.
+ * @param nranges Número de intervalos, em [1, VC_HSV_MAX_RANGES].
+ * @param counts Se não for NULL, recebe o número de pixels de cada intervalo.
+ * @return int Retorna 1 se a segmentação foi bem-sucedida, 0 caso contrário.
+ */
+VC_HSV_SEGMENTATION_RANGES_IMPL(vc_hsv_segmentation_ranges, VC_HUE_SCALE_VC)
+
+/**
+ * @brief Segmenta uma imagem HSV com Hue na escala do OpenCV ([0,180]) com vários intervalos numa única passagem.
+ * @author lugon
+ * @see vc_hsv_segmentation_ranges
+ */
+VC_HSV_SEGMENTATION_RANGES_IMPL(vc_hsv_segmentation_ranges_180, VC_HUE_SCALE_OPENCV)
+
+/**
+ * @brief Converte uma imagem de máscaras de bits numa imagem binária: 255 se algum dos bits pedidos está ativo.
+ * @author lugon
+ * @param src Imagem de máscaras (por exemplo, de vc_hsv_segmentation_ranges).
+ * @param dst Imagem binária de destino (0/255); pode ser a própria src.
+ * @param bits Bits (intervalos) a considerar, por exemplo (1 << 0) | (1 << 2).
+ * @return int Retorna 1 se a conversão foi bem-sucedida, 0 caso contrário.
+ */
+int vc_bitplane_to_binary(IVC* src, IVC* dst, unsigned char bits)
+{
+	LVC lut;
+	int i;
+
+	for (i = 0; i < 256; i++) lut.table[i] = (i & bits) ? 255 : 0;
+
+	if (!vc_gray_apply_lut(src, dst, &lut)) return 0;
+
+	dst->levels = 2;
+
+	return 1;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// FUNÇÕES: SEGMENTAÇÃO EM SEGMENTOS (RUN-LENGTH) E CAIXAS DELIMITADORAS
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Em vez de escrever uma máscara, cada linha é convertida em segmentos horizontais de frente.
+// Os segmentos de linhas consecutivas que se tocam (vizinhança-8) são unidos numa estrutura
+// union-find à medida que as linhas são lidas; no fim, cada conjunto dá um blob com a caixa
+// delimitadora, a área, o centro de massa e o perímetro. Uma imagem sem frente custa apenas a leitura.
+
+// Raiz do conjunto do segmento i (o pai de cada segmento nunca tem índice superior ao seu)
+static int vc_runs_find(RLVC runs[], int i)
+{
+	int root = i, next;
+
+	while (runs[root].label != root) root = runs[root].label;
+
+	// Compressão do caminho
+	while (runs[i].label != root)
+	{
+		next = runs[i].label;
+		runs[i].label = root;
+		i = next;
+	}
+
+	return root;
+}
+
+// Junta os conjuntos dos segmentos a e b, ficando como raiz o de menor índice
+static void vc_runs_union(RLVC runs[], int a, int b)
+{
+	a = vc_runs_find(runs, a);
+	b = vc_runs_find(runs, b);
+
+	if (a < b) runs[b].label = a;
+	else if (b < a) runs[a].label = b;
+}
+
+// Índice do bit a 1 menos significativo de m (m != 0)
+static int vc_bit_scan(unsigned int m)
+{
+#if defined(_MSC_VER)
+	unsigned long i;
+
+	_BitScanForward(&i, m);
+	return (int)i;
+#else
+	return __builtin_ctz(m);
+#endif
+}
+
+// Acrescenta o segmento [xstart, xend] da linha y. Retorna 0 se a capacidade de runs[] foi excedida.
+static int vc_runs_push(RLVC runs[], int maxruns, int* n, int y, int xstart, int xend)
+{
+	if (*n >= maxruns) return 0;
+
+	runs[*n].y = y;
+	runs[*n].xstart = xstart;
+	runs[*n].xend = xend;
+	runs[*n].label = *n;
+	(*n)++;
+
+	return 1;
+}
+
+// Acrescenta os segmentos de frente (valores != 0) de uma linha da máscara e une-os aos da linha
+// anterior, que ocupam [*prevstart, *nruns). Retorna 0 (sem alterar *nruns) se a capacidade de runs[]
+// foi excedida.
+// As transições fundo/frente são detetadas por blocos: m tem um bit por pixel de frente, e
+// m ^ (m << 1) marca os pixels que diferem do anterior (inícios e fins+1 de segmentos). Blocos
+// uniformes, de fundo ou de frente, não têm transições e custam uma comparação.
+static int vc_runs_add_row(unsigned char* row, int width, int y, RLVC runs[], int maxruns, int* nruns, int* prevstart)
+{
+	int x = 0, b, start = 0, p, n = *nruns, pend = *nruns;
+	unsigned int m, edges, last = 0;
+
+#if defined(VC_AVX2)
+	for (; x + 32 <= width; x += 32)
+	{
+		m = ~(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i*)(row + x)), _mm256_setzero_si256()));
+		edges = m ^ ((m << 1) | last);
+		last = m >> 31;
+		for (; edges != 0; edges &= edges - 1)
+		{
+			b = vc_bit_scan(edges);
+			if ((m >> b) & 1) start = x + b;
+			else if (!vc_runs_push(runs, maxruns, &n, y, start, x + b - 1)) return 0;
+		}
+	}
+#endif
+#if defined(VC_SSE2)
+	for (; x + 16 <= width; x += 16)
+	{
+		m = ~(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(row + x)), _mm_setzero_si128())) & 0xFFFF;
+		edges = (m ^ ((m << 1) | last)) & 0xFFFF;
+		last = m >> 15;
+		for (; edges != 0; edges &= edges - 1)
+		{
+			b = vc_bit_scan(edges);
+			if ((m >> b) & 1) start = x + b;
+			else if (!vc_runs_push(runs, maxruns, &n, y, start, x + b - 1)) return 0;
+		}
+	}
+#endif
+	for (; x < width; x++)
+	{
+		m = (row[x] != 0);
+		if (m && !last) start = x;
+		else if (!m && last && !vc_runs_push(runs, maxruns, &n, y, start, x - 1)) return 0;
+		last = m;
+	}
+	if (last && !vc_runs_push(runs, maxruns, &n, y, start, width - 1)) return 0;
+
+	// Une aos segmentos da linha anterior que se sobrepõem, incluindo na diagonal
+	for (p = *prevstart, start = pend; (p < pend) && (start < n);)
+	{
+		if (runs[p].xend + 1 < runs[start].xstart) p++;
+		else if (runs[start].xend + 1 < runs[p].xstart) start++;
+		else
+		{
+			vc_runs_union(runs, start, p);
+			if (runs[p].xend < runs[start].xend) p++;
+			else start++;
+		}
+	}
+
+	*prevstart = pend;
+	*nruns = n;
+
+	return 1;
+}
+
+// Número de pixels de [x0, x1] cobertos ao mesmo tempo por um segmento de [*pa, aend) e por um de
+// [*pb, bend) (duas linhas, ordenadas por coluna). *pa e *pb avançam até ao primeiro segmento que
+// não termina antes de x0, pelo que chamadas com x0 crescente percorrem cada linha uma só vez.
+static int vc_runs_covered(RLVC runs[], int* pa, int aend, int* pb, int bend, int x0, int x1)
+{
+	int i, j, s0, s1, c = 0;
+
+	while ((*pa < aend) && (runs[*pa].xend < x0)) (*pa)++;
+	while ((*pb < bend) && (runs[*pb].xend < x0)) (*pb)++;
+
+	for (i = *pa, j = *pb; (i < aend) && (runs[i].xstart <= x1); i++)
+	{
+		s0 = MAX(x0, runs[i].xstart);
+		s1 = MIN(x1, runs[i].xend);
+		for (; (j < bend) && (runs[j].xend < s0); j++);
+		for (; (j < bend) && (runs[j].xstart <= s1); j++)
+		{
+			c += MIN(s1, runs[j].xend) - MAX(s0, runs[j].xstart) + 1;
+			if (runs[j].xend > s1) break;
+		}
+	}
+
+	return c;
+}
+
+// Etiqueta os segmentos (label = índice do blob) e calcula os blobs, com o perímetro
+static int vc_runs_to_blobs(RLVC runs[], int nruns, OVC blobs[])
+{
+	int i, b, nblobs = 0, len, rend, nend, pstart, pend, pa, pb;
+	vc_blob_acc* acc;
+
+	// Estatísticas de cada blob (há no máximo nruns blobs)
+	acc = (vc_blob_acc*)malloc((size_t)MAX(nruns, 1) * sizeof(vc_blob_acc));
+	if (acc == NULL) return -1;
+
+	for (i = 0; i < nruns; i++)
+	{
+		// O pai tem índice inferior e já foi convertido em índice de blob
+		if (runs[i].label == i)
+		{
+			b = nblobs++;
+			blobs[b].label = b + 1;
+
+			// O primeiro segmento do blob dá o início da caixa delimitadora
+			vc_blob_acc_seed(&acc[b], runs[i].xstart, runs[i].y);
+		}
+		else b = runs[runs[i].label].label;
+		runs[i].label = b;
+
+		vc_blob_acc_add_run(&acc[b], runs[i].y, runs[i].xstart, runs[i].xend);
+	}
+
+	// Perímetro (pixels com algum dos 4 vizinhos de fundo ou fora da imagem): num segmento, só contam
+	// como interiores os pixels sem as extremidades que têm frente acima e abaixo
+	for (i = 0, pstart = 0; i < nruns; pstart = i, i = rend)
+	{
+		// Linha atual em [i, rend), anterior em [pa, pend) e seguinte em [pb, nend)
+		for (rend = i; (rend < nruns) && (runs[rend].y == runs[i].y); rend++);
+		for (nend = rend; (nend < nruns) && (runs[nend].y == runs[i].y + 1); nend++);
+		pa = pstart;
+		pend = (runs[pstart].y == runs[i].y - 1) ? i : pstart;
+		pb = rend;
+
+		for (b = i; b < rend; b++)
+		{
+			len = runs[b].xend - runs[b].xstart + 1;
+			if (len > 2) len -= vc_runs_covered(runs, &pa, pend, &pb, nend, runs[b].xstart + 1, runs[b].xend - 1);
+			acc[runs[b].label].perimeter += len;
+		}
+	}
+
+	for (b = 0; b < nblobs; b++) vc_blob_acc_finish(&acc[b], &blobs[b]);
+
+	free(acc);
+
+	return nblobs;
+}
+
+/**
+ * @brief Extrai os segmentos de frente de uma imagem binária e agrupa-os em blobs (vizinhança-8).
+ * @author lugon
+ * @param src Imagem binária (frente != 0).
+ * @param runs Array de saída com os segmentos, por ordem de linha e coluna; runs[i].label é o índice do blob.
+ * @param blobs Array de saída com os blobs (caixa delimitadora, área, centro de massa e perímetro); deve ter espaço para maxruns blobs.
+ * @param maxruns Capacidade de runs[] e de blobs[].
+ * @param nruns Recebe o número de segmentos.
+ * @param nblobs Recebe o número de blobs.
+ * @return int Retorna 1 se a extração foi bem-sucedida, 0 se houve um erro ou se a capacidade foi excedida.
+ */
+int vc_binary_runs(IVC* src, RLVC runs[], OVC blobs[], int maxruns, int* nruns, int* nblobs)
+{
+	int y, prevstart = 0, n = 0;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL) || (src->channels != 1)) return 0;
+	if ((runs == NULL) || (blobs == NULL) || (nruns == NULL) || (nblobs == NULL)) return 0;
+
+	for (y = 0; y < src->height; y++)
+	{
+		if (!vc_runs_add_row(src->data + (long int)y * src->width, src->width, y, runs, maxruns, &n, &prevstart)) return 0;
+	}
+
+	*nruns = n;
+	*nblobs = vc_runs_to_blobs(runs, n, blobs);
+
+	return (*nblobs >= 0);
+}
+
+/**
+ * @brief Etiquetagem de blobs (vizinhança-8) a partir dos segmentos horizontais de frente.
+ * Ao contrário de vc_binary_runs, os arrays são alocados pela função. O custo da ligação entre linhas e
+ * das estatísticas é proporcional ao número de segmentos, e não de pixels; os blobs (área, caixa
+ * delimitadora, centro de gravidade e perímetro) são iguais aos de vc_binary_blob_labelling32.
+ * @author lugon
+ * @param src Imagem binária de entrada (frente != 0).
+ * @param nlabels Endereço de memória de uma variável onde será armazenado o número de blobs.
+ * @param runs Se != NULL, recebe o array de segmentos (a libertar pelo chamador), com runs[i].label = índice do blob.
+ * @param nruns Se != NULL, recebe o número de segmentos.
+ * @return OVC* Array de nlabels blobs, com blobs[i].label = i + 1, ou NULL se não há blobs ou houve um erro.
+ */
+OVC* vc_binary_blob_labelling_runs(IVC* src, int* nlabels, RLVC** runs, int* nruns)
+{
+	RLVC *r, *grown;
+	OVC* blobs;
+	int y, n = 0, prevstart = 0, nblobs;
+	long int maxruns, limit;
+
+	*nlabels = 0;
+	if (runs != NULL) *runs = NULL;
+	if (nruns != NULL) *nruns = 0;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL) || (src->channels != 1)) return NULL;
+
+	// Capacidade inicial de 4 segmentos por linha, duplicada sempre que uma linha não cabe (no máximo,
+	// há um segmento por cada 2 pixels)
+	limit = (long int)src->height * ((src->width + 1) / 2);
+	maxruns = MIN(4L * src->height, limit);
+	r = (RLVC*)malloc((size_t)maxruns * sizeof(RLVC));
+	if (r == NULL) return NULL;
+
+	for (y = 0; y < src->height;)
+	{
+		if (vc_runs_add_row(src->data + (long int)y * src->bytesperline, src->width, y, r, (int)maxruns, &n, &prevstart))
+		{
+			y++;
+			continue;
+		}
+
+		maxruns = MIN(2 * maxruns, limit);
+		grown = (RLVC*)realloc(r, (size_t)maxruns * sizeof(RLVC));
+		if (grown == NULL)
+		{
+			free(r);
+			return NULL;
+		}
+		r = grown;
+	}
+
+	blobs = (OVC*)malloc((size_t)MAX(n, 1) * sizeof(OVC));
+	nblobs = (blobs != NULL) ? vc_runs_to_blobs(r, n, blobs) : -1;
+	if (nblobs <= 0)
+	{
+		free(blobs);
+		blobs = NULL;
+	}
+	else *nlabels = nblobs;
+
+	if ((runs != NULL) && (nblobs >= 0))
+	{
+		*runs = r;
+		if (nruns != NULL) *nruns = n;
+	}
+	else free(r);
+
+	return blobs;
+}
+
+/**
+ * @brief Gera uma função de segmentação HSV que produz segmentos e blobs em vez de uma máscara.
+ * A máscara de cada linha é calculada num buffer de uma linha, que não sai da cache.
+ * @author lugon
+ */
+#define VC_HSV_SEGMENTATION_RUNS_IMPL(name, HMAX) \
+int name(IVC* src, RVC ranges[], int nranges, RLVC runs[], OVC blobs[], int maxruns, int* nruns, int* nblobs) \
+{ \
+	unsigned char th[256], ts[256], tv[256]; \
+	unsigned char* row; \
+	int y, prevstart = 0, n = 0, ok = 1; \
+ \
+	/* Verificação de erros */ \
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL) || (src->channels != 3)) return 0; \
+	if ((runs == NULL) || (blobs == NULL) || (nruns == NULL) || (nblobs == NULL)) return 0; \
+	if (!vc_hsv_tables_build(ranges, nranges, (HMAX), th, ts, tv)) return 0; \
+ \
+	row = (unsigned char*)malloc(src->width); \
+	if (row == NULL) return 0; \
+ \
+	for (y = 0; (y < src->height) && ok; y++) \
+	{ \
+		vc_hsv_mask_run(src->data + (long int)y * src->width * 3, row, src->width, th, ts, tv); \
+		ok = vc_runs_add_row(row, src->width, y, runs, maxruns, &n, &prevstart); \
+	} \
+	free(row); \
+	if (!ok) return 0; \
+ \
+	*nruns = n; \
+	*nblobs = vc_runs_to_blobs(runs, n, blobs); \
+ \
+	return (*nblobs >= 0); \
+}
+
+/**
+ * @brief Segmenta uma imagem HSV (Hue em [0,255]) diretamente em segmentos e blobs, sem escrever a máscara.
+ * Um pixel é de frente se pertence a algum dos intervalos.
+ * @author lugon
+ * @param src Imagem de entrada em HSV.
+ * @param ranges Intervalos de cor (minHue > maxHue dá a volta pelo 0).
+ * @param nranges Número de intervalos, em [1, VC_HSV_MAX_RANGES].
+ * @param runs Array de saída com os segmentos; runs[i].label é o índice do blob.
+ * @param blobs Array de saída com os blobs; deve ter espaço para maxruns blobs.
+ * @param maxruns Capacidade de runs[] e de blobs[].
+ * @param nruns Recebe o número de segmentos.
+ * @param nblobs Recebe o número de blobs.
+ * @return int Retorna 1 se a segmentação foi bem-sucedida, 0 se houve um erro ou se a capacidade foi excedida.
+ */
+VC_HSV_SEGMENTATION_RUNS_IMPL(vc_hsv_segmentation_runs, VC_HUE_SCALE_VC)
+
+/**
+ * @brief Segmenta uma imagem HSV com Hue na escala do OpenCV ([0,180]) diretamente em segmentos e blobs.
+ * @author lugon
+ * @see vc_hsv_segmentation_runs
+ */
+VC_HSV_SEGMENTATION_RUNS_IMPL(vc_hsv_segmentation_runs_180, VC_HUE_SCALE_OPENCV)
+
+/**
+ * @brief Desenha os segmentos numa imagem binária (255 nos segmentos, 0 no resto).
+ * @author lugon
+ * @param dst Imagem binária de destino.
+ * @param runs Segmentos a desenhar.
+ * @param nruns Número de segmentos.
+ * @return int Retorna 1 se a imagem foi desenhada, 0 se houve um erro.
+ */
+int vc_runs_to_binary(IVC* dst, RLVC runs[], int nruns)
+{
+	int i;
+
+	// Verificação de erros
+	if ((dst->width <= 0) || (dst->height <= 0) || (dst->data == NULL) || (dst->channels != 1)) return 0;
+	if ((runs == NULL) && (nruns > 0)) return 0;
+
+	memset(dst->data, 0, (size_t)dst->width * dst->height);
+
+	for (i = 0; i < nruns; i++)
+	{
+		if ((runs[i].y < 0) || (runs[i].y >= dst->height) || (runs[i].xstart < 0) || (runs[i].xend >= dst->width)) return 0;
+		memset(dst->data + (long int)runs[i].y * dst->width + runs[i].xstart, 255, runs[i].xend - runs[i].xstart + 1);
+	}
+
+	dst->levels = 2;
+
+	return 1;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//           FUNÇÕES: DETEÇÃO DE ALTERAÇÕES POR BLOCOS
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Com a câmara fixa, frames consecutivas são quase iguais. A imagem é dividida em blocos e, para cada
+// bloco, é calculada a soma das diferenças absolutas (SAD) em relação à frame anterior; só os blocos
+// com diferença acima do limiar precisam de ser reprocessados.
+
+// Soma das diferenças absolutas entre n bytes de a e de b
+static unsigned long vc_sad_run(unsigned char* a, unsigned char* b, int n)
+{
+	unsigned long sad = 0;
+	int i = 0;
+
+#if defined(VC_AVX2)
+	__m256i acc = _mm256_setzero_si256();
+	for (; i + 32 <= n; i += 32)
+	{
+		acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_loadu_si256((__m256i*)(a + i)), _mm256_loadu_si256((__m256i*)(b + i))));
+	}
+	sad += (unsigned long)(_mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1) + _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3));
+#endif
+#if defined(VC_SSE2)
+	{
+		__m128i acc128 = _mm_setzero_si128();
+		for (; i + 16 <= n; i += 16)
+		{
+			acc128 = _mm_add_epi64(acc128, _mm_sad_epu8(_mm_loadu_si128((__m128i*)(a + i)), _mm_loadu_si128((__m128i*)(b + i))));
+		}
+		sad += (unsigned long)_mm_cvtsi128_si32(acc128) + (unsigned long)_mm_cvtsi128_si32(_mm_srli_si128(acc128, 8));
+	}
+#endif
+
+	for (; i < n; i++) sad += (a[i] > b[i]) ? a[i] - b[i] : b[i] - a[i];
+
+	return sad;
+}
+
+/**
+ * @brief Marca os blocos tilesize x tilesize em que a imagem mudou em relação à frame anterior.
+ * Um bloco muda se a diferença absoluta média por byte for superior a threshold.
+ * @author lugon
+ * @param src Imagem atual.
+ * @param prev Imagem anterior, com as mesmas dimensões e número de canais.
+ * @param tilesize Lado dos blocos, em pixels.
+ * @param threshold Diferença absoluta média por byte tolerada (ruído de compressão, por exemplo).
+ * @param dirty Se não for NULL, recebe 1 nos blocos alterados e 0 nos restantes, por linhas de blocos
+ * ((width + tilesize - 1) / tilesize blocos por linha).
+ * @param ndirty Recebe o número de blocos alterados.
+ * @return int Retorna 1 se a comparação foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_image_tile_changes(IVC* src, IVC* prev, int tilesize, int threshold, unsigned char dirty[], int* ndirty)
+{
+	int width = src->width;
+	int height = src->height;
+	int channels = src->channels;
+	int bytesperline = width * channels;
+	int tilesx, tilesy, tx, ty, y, y1, x0, n, count = 0;
+	unsigned long* sad;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL) || (prev->data == NULL)) return 0;
+	if ((src->width != prev->width) || (src->height != prev->height) || (src->channels != prev->channels)) return 0;
+	if ((tilesize <= 0) || (threshold < 0) || (ndirty == NULL)) return 0;
+
+	tilesx = (width + tilesize - 1) / tilesize;
+	tilesy = (height + tilesize - 1) / tilesize;
+
+	sad = (unsigned long*)malloc(tilesx * sizeof(unsigned long));
+	if (sad == NULL) return 0;
+
+	for (ty = 0; ty < tilesy; ty++)
+	{
+		// As linhas do bloco são lidas por inteiro, acumulando a SAD de cada bloco da linha
+		memset(sad, 0, tilesx * sizeof(unsigned long));
+		y1 = MIN((ty + 1) * tilesize, height);
+		for (y = ty * tilesize; y < y1; y++)
+		{
+			for (tx = 0; tx < tilesx; tx++)
+			{
+				x0 = tx * tilesize * channels;
+				n = MIN(tilesize * channels, bytesperline - x0);
+				sad[tx] += vc_sad_run(src->data + (long int)y * bytesperline + x0, prev->data + (long int)y * bytesperline + x0, n);
+			}
+		}
+
+		for (tx = 0; tx < tilesx; tx++)
+		{
+			// Número de bytes do bloco (os blocos da última linha e coluna podem ser menores)
+			n = (y1 - ty * tilesize) * MIN(tilesize * channels, bytesperline - tx * tilesize * channels);
+			if (sad[tx] > (unsigned long)threshold * n)
+			{
+				count++;
+				if (dirty != NULL) dirty[ty * tilesx + tx] = 1;
+			}
+			else if (dirty != NULL) dirty[ty * tilesx + tx] = 0;
+		}
+	}
+
+	free(sad);
+
+	*ndirty = count;
+
+	return 1;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//      FUNÇÕES: MORFOLOGIA BINÁRIA EM MÁSCARAS DE BITS
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Numa máscara compactada, a dilatação horizontal é o OR da linha com cópias de si própria
+// deslocadas, e a vertical é o OR de linhas inteiras. Cada extensão de n pixels é feita por
+// duplicação (1, 2, 4, ... pixels), em O(log n) passagens sobre 1/8 dos dados de uma imagem de bytes.
+// A erosão é o complemento da dilatação do complemento (os vizinhos fora da imagem continuam ignorados).
+
+// Máscara dos bits válidos da última palavra de cada linha
+static unsigned long long vc_bitmask_lastword(int width)
+{
+	return (width % 64) ? ((1ULL << (width % 64)) - 1) : ~0ULL;
+}
+
+/**
+ * @brief Aloca uma máscara de bits com todos os pixels a 0.
+ * @author lugon
+ * @param width Largura em pixels.
+ * @param height Altura em pixels.
+ * @return BVC* Máscara alocada, ou NULL em caso de erro.
+ */
+BVC* vc_bitmask_new(int width, int height)
+{
+	BVC* mask;
+
+	if ((width <= 0) || (height <= 0)) return NULL;
+
+	mask = (BVC*)malloc(sizeof(BVC));
+	if (mask == NULL) return NULL;
+
+	mask->width = width;
+	mask->height = height;
+	mask->wordsperline = (width + 63) / 64;
+	mask->data = (unsigned long long*)calloc((size_t)mask->wordsperline * height, sizeof(unsigned long long));
+	if (mask->data == NULL) return vc_bitmask_free(mask);
+
+	return mask;
+}
+
+/**
+ * @brief Liberta uma máscara de bits.
+ * @author lugon
+ * @param mask Máscara a libertar (pode ser NULL).
+ * @return BVC* Retorna sempre NULL.
+ */
+BVC* vc_bitmask_free(BVC* mask)
+{
+	if (mask != NULL)
+	{
+		free(mask->data);
+		free(mask);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Compacta uma imagem de 1 canal numa máscara de bits: frente se o nível for >= threshold.
+ * Com AVX2/SSE2, cada 32/16 pixels são comparados e compactados com um movemask.
+ * @author lugon
+ * @param src Imagem de origem com 1 canal.
+ * @param dst Máscara de destino, com as mesmas dimensões.
+ * @param threshold Nível mínimo da frente (255 para máscaras 0/255 em que só 255 é frente, 1 para frente != 0).
+ * @return int Retorna 1 se a compactação foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_binary_to_bitmask(IVC* src, BVC* dst, unsigned char threshold)
+{
+	int width = src->width;
+	int x, y, w;
+	unsigned char* row;
+	unsigned long long word, *out;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL) || (src->channels != 1)) return 0;
+	if ((dst == NULL) || (dst->width != src->width) || (dst->height != src->height)) return 0;
+
+	for (y = 0; y < src->height; y++)
+	{
+		row = src->data + (long int)y * width;
+		out = dst->data + (long int)y * dst->wordsperline;
+
+		for (w = 0, x = 0; w < dst->wordsperline; w++, x += 64)
+		{
+			word = 0;
+			if (x + 64 <= width)
+			{
+#if defined(VC_AVX2)
+				__m256i t = _mm256_set1_epi8((char)threshold);
+				__m256i v0 = _mm256_loadu_si256((__m256i*)(row + x));
+				__m256i v1 = _mm256_loadu_si256((__m256i*)(row + x + 32));
+				// v >= t  <=>  max(v, t) == v
+				word = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(v0, t), v0));
+				word |= (unsigned long long)(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(v1, t), v1)) << 32;
+#elif defined(VC_SSE2)
+				__m128i t = _mm_set1_epi8((char)threshold);
+				__m128i v;
+				int k;
+				for (k = 0; k < 4; k++)
+				{
+					v = _mm_loadu_si128((__m128i*)(row + x + 16 * k));
+					word |= (unsigned long long)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, t), v)) << (16 * k);
+				}
+#else
+				int k;
+				for (k = 0; k < 64; k++) word |= (unsigned long long)(row[x + k] >= threshold) << k;
+#endif
+			}
+			else
+			{
+				int k;
+				for (k = 0; x + k < width; k++) word |= (unsigned long long)(row[x + k] >= threshold) << k;
+			}
+			out[w] = word;
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * @brief Expande uma máscara de bits para uma imagem binária 0/255.
+ * @author lugon
+ * @param src Máscara de origem.
+ * @param dst Imagem binária de destino, com as mesmas dimensões.
+ * @return int Retorna 1 se a expansão foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_bitmask_to_binary(BVC* src, IVC* dst)
+{
+	int width = src->width;
+	int x, y, w, k;
+	unsigned char* row;
+	unsigned long long word, *in;
+
+	// Verificação de erros
+	if ((dst->width <= 0) || (dst->height <= 0) || (dst->data == NULL) || (dst->channels != 1)) return 0;
+	if ((dst->width != src->width) || (dst->height != src->height)) return 0;
+
+	for (y = 0; y < src->height; y++)
+	{
+		row = dst->data + (long int)y * width;
+		in = src->data + (long int)y * src->wordsperline;
+
+		for (w = 0, x = 0; w < src->wordsperline; w++, x += 64)
+		{
+			word = in[w];
+			k = 0;
+#if defined(VC_AVX2)
+			if (x + 64 <= width)
+			{
+				// Cada byte recebe o byte da palavra que contém o seu bit, que é depois isolado e comparado
+				__m256i shuf = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+					2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+				__m256i bit = _mm256_set1_epi64x((long long)0x8040201008040201ULL);
+				__m256i v;
+				for (; k < 64; k += 32)
+				{
+					v = _mm256_shuffle_epi8(_mm256_set1_epi32((int)(unsigned int)(word >> k)), shuf);
+					_mm256_storeu_si256((__m256i*)(row + x + k), _mm256_cmpeq_epi8(_mm256_and_si256(v, bit), bit));
+				}
+			}
+#endif
+			for (; (k < 64) && (x + k < width); k++) row[x + k] = ((word >> k) & 1) ? 255 : 0;
+		}
+	}
+
+	dst->levels = 2;
+
+	return 1;
+}
+
+// row[x] |= row[x + s]: estende a frente s pixels para a esquerda (palavras por ordem crescente)
+static void vc_bits_or_from_right(unsigned long long* row, int nwords, int s)
+{
+	int q = s >> 6, b = s & 63, i;
+	unsigned long long v;
+
+	for (i = 0; i + q < nwords; i++)
+	{
+		v = row[i + q] >> b;
+		if (b && (i + q + 1 < nwords)) v |= row[i + q + 1] << (64 - b);
+		row[i] |= v;
+	}
+}
+
+// row[x] |= row[x - s]: estende a frente s pixels para a direita (palavras por ordem decrescente)
+static void vc_bits_or_from_left(unsigned long long* row, int nwords, int s)
+{
+	int q = s >> 6, b = s & 63, i;
+	unsigned long long v;
+
+	for (i = nwords - 1; i - q >= 0; i--)
+	{
+		v = row[i - q] << b;
+		if (b && (i - q - 1 >= 0)) v |= row[i - q - 1] >> (64 - b);
+		row[i] |= v;
+	}
+}
+
+// dst |= src, n palavras (256 pixels por instrução com AVX2)
+static void vc_bits_or_words(unsigned long long* dst, unsigned long long* src, int n)
+{
+	int i = 0;
+
+#if defined(VC_AVX2)
+	for (; i + 4 <= n; i += 4)
+	{
+		_mm256_storeu_si256((__m256i*)(dst + i), _mm256_or_si256(_mm256_loadu_si256((__m256i*)(dst + i)), _mm256_loadu_si256((__m256i*)(src + i))));
+	}
+#endif
+	for (; i < n; i++) dst[i] |= src[i];
+}
+
+// Linha y |= linha y + s (dir = 0, por ordem crescente) ou linha y |= linha y - s (dir = 1, por ordem decrescente)
+static void vc_bitmask_or_rows(BVC* mask, int s, int dir)
+{
+	int wpl = mask->wordsperline;
+	int y;
+
+	if (dir == 0)
+	{
+		for (y = 0; y + s < mask->height; y++) vc_bits_or_words(mask->data + (long int)y * wpl, mask->data + (long int)(y + s) * wpl, wpl);
+	}
+	else
+	{
+		for (y = mask->height - 1; y - s >= 0; y--) vc_bits_or_words(mask->data + (long int)y * wpl, mask->data + (long int)(y - s) * wpl, wpl);
+	}
+}
+
+// row[x] = OR de row[x..x+n] (dir = 0) ou row[x-n..x] (dir = 1), por duplicação
+static void vc_bits_spread_row(unsigned long long* row, int nwords, int n, int dir)
+{
+	int cover;
+
+	for (cover = 1; cover * 2 <= n + 1; cover *= 2)
+	{
+		if (dir == 0) vc_bits_or_from_right(row, nwords, cover);
+		else vc_bits_or_from_left(row, nwords, cover);
+	}
+	if (n + 1 > cover)
+	{
+		if (dir == 0) vc_bits_or_from_right(row, nwords, n + 1 - cover);
+		else vc_bits_or_from_left(row, nwords, n + 1 - cover);
+	}
+}
+
+// Linha y = OR das linhas y..y+n (dir = 0) ou y-n..y (dir = 1), por duplicação
+static void vc_bitmask_spread_rows(BVC* mask, int n, int dir)
+{
+	int cover;
+
+	for (cover = 1; cover * 2 <= n + 1; cover *= 2) vc_bitmask_or_rows(mask, cover, dir);
+	if (n + 1 > cover) vc_bitmask_or_rows(mask, n + 1 - cover, dir);
+}
+
+// Dilatação com um retângulo de raios rx (horizontal) e ry (vertical), no próprio lugar
+static void vc_bitmask_dilate_inplace(BVC* mask, int rx, int ry)
+{
+	int wpl = mask->wordsperline;
+	unsigned long long last = vc_bitmask_lastword(mask->width);
+	unsigned long long* row;
+	int y;
+
+	// Horizontal: para cada sentido, cobre os deslocamentos 0..rx por duplicação
+	if (rx > 0)
+	{
+		for (y = 0; y < mask->height; y++)
+		{
+			row = mask->data + (long int)y * wpl;
+
+			vc_bits_spread_row(row, wpl, rx, 0);
+			vc_bits_spread_row(row, wpl, rx, 1);
+
+			row[wpl - 1] &= last;
+		}
+	}
+
+	// Vertical: o mesmo com linhas inteiras
+	if (ry > 0)
+	{
+		vc_bitmask_spread_rows(mask, ry, 0);
+		vc_bitmask_spread_rows(mask, ry, 1);
+	}
+}
+
+// Complemento da máscara, mantendo a 0 os bits além de width
+static void vc_bitmask_invert(BVC* mask)
+{
+	unsigned long long last = vc_bitmask_lastword(mask->width);
+	long int i, n = (long int)mask->wordsperline * mask->height;
+
+	for (i = 0; i < n; i++) mask->data[i] = ~mask->data[i];
+	for (i = mask->wordsperline - 1; i < n; i += mask->wordsperline) mask->data[i] &= last;
+}
+
+// Copia src para dst (se forem máscaras diferentes) e valida o kernel
+static int vc_bitmask_prepare(BVC* src, BVC* dst, int kernel)
+{
+	if ((src == NULL) || (dst == NULL) || (src->data == NULL) || (dst->data == NULL)) return 0;
+	if ((src->width != dst->width) || (src->height != dst->height) || (kernel < 1)) return 0;
+
+	if (src != dst) memcpy(dst->data, src->data, (size_t)src->wordsperline * src->height * sizeof(unsigned long long));
+
+	return 1;
+}
+
+/**
+ * @brief Dilatação binária de uma máscara de bits com kernel quadrado de lado 2 * (kernel / 2) + 1.
+ * Os vizinhos fora da imagem são ignorados, como em vc_binary_dilate.
+ * @author lugon
+ * @param src Máscara de origem.
+ * @param dst Máscara de destino (pode ser a própria src).
+ * @param kernel Tamanho do kernel.
+ * @return int Retorna 1 se a dilatação foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_bitmask_dilate(BVC* src, BVC* dst, int kernel)
+{
+	if (!vc_bitmask_prepare(src, dst, kernel)) return 0;
+
+	vc_bitmask_dilate_inplace(dst, kernel / 2, kernel / 2);
+
+	return 1;
+}
+
+/**
+ * @brief Erosão binária de uma máscara de bits com kernel quadrado de lado 2 * (kernel / 2) + 1.
+ * Os vizinhos fora da imagem são ignorados, como em vc_binary_erode.
+ * @author lugon
+ * @param src Máscara de origem.
+ * @param dst Máscara de destino (pode ser a própria src).
+ * @param kernel Tamanho do kernel.
+ * @return int Retorna 1 se a erosão foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_bitmask_erode(BVC* src, BVC* dst, int kernel)
+{
+	if (!vc_bitmask_prepare(src, dst, kernel)) return 0;
+
+	// Erosão = complemento da dilatação do fundo (o exterior da imagem não é fundo)
+	vc_bitmask_invert(dst);
+	vc_bitmask_dilate_inplace(dst, kernel / 2, kernel / 2);
+	vc_bitmask_invert(dst);
+
+	return 1;
+}
+
+/**
+ * @brief Aplica uma sequência de erosões e dilatações binárias com uma única leitura e uma única escrita da imagem.
+ * A imagem é compactada uma vez numa máscara de bits (1/8 do tamanho, que fica na cache), todas as
+ * operações são feitas sobre os bits e o resultado é expandido uma vez para dst. O resultado é igual ao
+ * de chamar vc_binary_erode/vc_binary_dilate em sequência: a primeira operação define o critério de
+ * frente (>= 1 para a erosão, 255 para a dilatação); as imagens intermédias seriam 0/255.
+ * @author lugon
+ * @param src Imagem binária de entrada.
+ * @param dst Imagem binária de saída (0/255); pode ser a própria src.
+ * @param ops Operações (VC_MORPH_ERODE ou VC_MORPH_DILATE).
+ * @param kernels Tamanho do kernel quadrado de cada operação.
+ * @param nops Número de operações.
+ * @return int Retorna 1 se a sequência foi aplicada, 0 se houve um erro.
+ */
+int vc_binary_morphology_sequence(IVC* src, IVC* dst, int ops[], int kernels[], int nops)
+{
+	BVC* mask;
+	int i, ok;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
+	if ((dst->width != src->width) || (dst->height != src->height) || (dst->data == NULL)) return 0;
+	if ((src->channels != 1) || (dst->channels != 1)) return 0;
+	if ((ops == NULL) || (kernels == NULL) || (nops < 1)) return 0;
+	for (i = 0; i < nops; i++)
+	{
+		if (((ops[i] != VC_MORPH_ERODE) && (ops[i] != VC_MORPH_DILATE)) || (kernels[i] < 1)) return 0;
+	}
+
+	mask = vc_bitmask_new(src->width, src->height);
+	if (mask == NULL) return 0;
+
+	ok = vc_binary_to_bitmask(src, mask, (ops[0] == VC_MORPH_DILATE) ? 255 : 1);
+	for (i = 0; (i < nops) && ok; i++)
+	{
+		if (ops[i] == VC_MORPH_DILATE) ok = vc_bitmask_dilate(mask, mask, kernels[i]);
+		else ok = vc_bitmask_erode(mask, mask, kernels[i]);
+	}
+	if (ok) ok = vc_bitmask_to_binary(mask, dst);
+
+	vc_bitmask_free(mask);
+
+	return ok;
+}
+
+/**
+ * @brief Abertura binária (erosão seguida de dilatação com o mesmo kernel), sem imagem intermédia.
+ * @author lugon
+ * @param src Imagem binária de entrada.
+ * @param dst Imagem binária de saída.
+ * @param kernel Tamanho do kernel.
+ * @return int Retorna 1 se a abertura foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_binary_open(IVC* src, IVC* dst, int kernel)
+{
+	int ops[2] = { VC_MORPH_ERODE, VC_MORPH_DILATE };
+	int kernels[2] = { kernel, kernel };
+
+	return vc_binary_morphology_sequence(src, dst, ops, kernels, 2);
+}
+
+/**
+ * @brief Fecho binário (dilatação seguida de erosão com o mesmo kernel), sem imagem intermédia.
+ * @author lugon
+ * @param src Imagem binária de entrada.
+ * @param dst Imagem binária de saída.
+ * @param kernel Tamanho do kernel.
+ * @return int Retorna 1 se o fecho foi bem-sucedido, 0 se houve um erro.
+ */
+int vc_binary_close(IVC* src, IVC* dst, int kernel)
+{
+	int ops[2] = { VC_MORPH_DILATE, VC_MORPH_ERODE };
+	int kernels[2] = { kernel, kernel };
+
+	return vc_binary_morphology_sequence(src, dst, ops, kernels, 2);
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//         FUNÇÕES: ELEMENTOS ESTRUTURANTES ARBITRÁRIOS
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// A dilatação com um elemento B é o OR da máscara deslocada por cada ponto de B. O elemento é
+// decomposto automaticamente:
+//  - retângulos usam a passagem separável por duplicação (O(log) passagens);
+//  - elementos até 3x3 e 5x5 usam kernels de uma passagem, gerados por macro com o tamanho
+//    constante: as linhas da vizinhança são combinadas por OR para cada padrão de coluna distinto,
+//    e cada coluna do elemento aplica depois um só deslocamento;
+//  - nos restantes, cada linha de src é estendida uma vez para cada par distinto (comprimento,
+//    deslocamento) dos segmentos horizontais do elemento, por duplicação a partir do par anterior,
+//    para um anel com as linhas da janela vertical; cada linha de dst é o OR das linhas do anel.
+// Um disco, uma cruz ou uma linha custam assim uma passagem por linha de src e por par, mais uma por
+// linha de dst: tanto como o quadrado envolvente até raios da ordem de 12, mais acima (o quadrado é
+// logarítmico no tamanho, a decomposição por linhas é linear na altura do elemento).
+
+/**
+ * @brief Aloca um elemento estruturante vazio (todos os pontos a 0), com a origem no centro.
+ * @author lugon
+ * @param width Largura (ímpar).
+ * @param height Altura (ímpar).
+ * @return EVC* Elemento alocado, ou NULL em caso de erro.
+ */
+EVC* vc_se_new(int width, int height)
+{
+	EVC* se;
+
+	if ((width <= 0) || (height <= 0) || (width % 2 == 0) || (height % 2 == 0)) return NULL;
+
+	se = (EVC*)malloc(sizeof(EVC));
+	if (se == NULL) return NULL;
+
+	se->width = width;
+	se->height = height;
+	se->data = (unsigned char*)calloc((size_t)width * height, 1);
+	if (se->data == NULL) return vc_se_free(se);
+
+	return se;
+}
+
+/**
+ * @brief Liberta um elemento estruturante.
+ * @author lugon
+ * @param se Elemento a libertar (pode ser NULL).
+ * @return EVC* Retorna sempre NULL.
+ */
+EVC* vc_se_free(EVC* se)
+{
+	if (se != NULL)
+	{
+		free(se->data);
+		free(se);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Elemento estruturante retangular.
+ * @author lugon
+ * @param width Largura (ímpar).
+ * @param height Altura (ímpar).
+ * @return EVC* Elemento alocado, ou NULL em caso de erro.
+ */
+EVC* vc_se_rect(int width, int height)
+{
+	EVC* se = vc_se_new(width, height);
+
+	if (se != NULL) memset(se->data, 1, (size_t)width * height);
+
+	return se;
+}
+
+/**
+ * @brief Elemento estruturante em cruz (linha e coluna centrais).
+ * @author lugon
+ * @param size Lado (ímpar).
+ * @return EVC* Elemento alocado, ou NULL em caso de erro.
+ */
+EVC* vc_se_cross(int size)
+{
+	EVC* se = vc_se_new(size, size);
+	int i;
+
+	if (se == NULL) return NULL;
+
+	for (i = 0; i < size; i++)
+	{
+		se->data[(size / 2) * size + i] = 1;
+		se->data[i * size + size / 2] = 1;
+	}
+
+	return se;
+}
+
+/**
+ * @brief Elemento estruturante em disco: pontos com x^2 + y^2 <= radius^2.
+ * @author lugon
+ * @param radius Raio, em pixels.
+ * @return EVC* Elemento de lado 2 * radius + 1, ou NULL em caso de erro.
+ */
+EVC* vc_se_disk(int radius)
+{
+	EVC* se;
+	int x, y, size = 2 * radius + 1;
+
+	if (radius < 0) return NULL;
+
+	se = vc_se_new(size, size);
+	if (se == NULL) return NULL;
+
+	for (y = -radius; y <= radius; y++)
+	{
+		for (x = -radius; x <= radius; x++)
+		{
+			if (x * x + y * y <= radius * radius) se->data[(y + radius) * size + (x + radius)] = 1;
+		}
+	}
+
+	return se;
+}
+
+/**
+ * @brief Elemento estruturante em linha, centrada na origem, com um ângulo qualquer.
+ * @author lugon
+ * @param length Comprimento, em pixels (ímpar, para a linha ficar centrada na origem).
+ * @param angle Ângulo em graus, no sentido anti-horário a partir do eixo x (0 = horizontal, 90 = vertical).
+ * @return EVC* Elemento alocado, ou NULL em caso de erro (incluindo um comprimento par).
+ */
+EVC* vc_se_line(int length, float angle)
+{
+	EVC* se;
+	double rad = angle * 3.14159265358979323846 / 180.0;
+	double c = cos(rad), sn = sin(rad);
+	int t, x, y, rx = 0, ry = 0, half = length / 2;
+
+	if ((length < 1) || (length % 2 == 0)) return NULL;
+
+	// Dimensões: maior afastamento da origem em x e em y
+	for (t = -half; t <= half; t++)
+	{
+		x = (int)floor(t * c + 0.5);
+		y = (int)floor(-t * sn + 0.5);
+		rx = MAX(rx, MAX(x, -x));
+		ry = MAX(ry, MAX(y, -y));
+	}
+
+	se = vc_se_new(2 * rx + 1, 2 * ry + 1);
+	if (se == NULL) return NULL;
+
+	for (t = -half; t <= half; t++)
+	{
+		x = (int)floor(t * c + 0.5);
+		y = (int)floor(-t * sn + 0.5);
+		se->data[(y + ry) * se->width + (x + rx)] = 1;
+	}
+
+	return se;
+}
+
+// dst[x] = base[x] | src[x + a] (base pode ser NULL, e dst pode ser base), em n palavras, com a de
+// qualquer sinal. src tem de ter palavras válidas (a 0 fora dos dados) de src[floor(a / 64)] a
+// src[n + floor(a / 64)]
+static void vc_bits_offset(unsigned long long* dst, unsigned long long* base, unsigned long long* src, int n, int a)
+{
+	int q = (a >= 0) ? a / 64 : -((63 - a) / 64);
+	int s = a - 64 * q, i = 0;
+	unsigned long long *p = src + q, v;
+
+#if defined(VC_AVX2)
+	// Com s = 0, o deslocamento de 64 bits dá 0
+	__m128i cr = _mm_cvtsi32_si128(s), cl = _mm_cvtsi32_si128(64 - s);
+	__m256i w;
+	for (; i + 4 <= n; i += 4)
+	{
+		w = _mm256_or_si256(_mm256_srl_epi64(_mm256_loadu_si256((__m256i*)(p + i)), cr), _mm256_sll_epi64(_mm256_loadu_si256((__m256i*)(p + i + 1)), cl));
+		if (base != NULL) w = _mm256_or_si256(w, _mm256_loadu_si256((__m256i*)(base + i)));
+		_mm256_storeu_si256((__m256i*)(dst + i), w);
+	}
+#endif
+	for (; i < n; i++)
+	{
+		v = (s == 0) ? p[i] : (p[i] >> s) | (p[i + 1] << (64 - s));
+		dst[i] = (base != NULL) ? base[i] | v : v;
+	}
+}
+
+// dst[x] = base[x] | src[x - d] | src[x + d] (base pode ser NULL), em n palavras, com d >= 0. src tem de ter
+// palavras válidas de src[-d / 64 - 1] a src[n + d / 64]
+static void vc_bits_spread(unsigned long long* dst, unsigned long long* base, unsigned long long* src, int n, int d)
+{
+	int q = d / 64, s = d % 64, i = 0;
+	unsigned long long *p = src + q, *m = src - q, v;
+
+#if defined(VC_AVX2)
+	// Com s = 0, os deslocamentos de 64 bits dão 0
+	__m128i cs = _mm_cvtsi32_si128(s), cc = _mm_cvtsi32_si128(64 - s);
+	__m256i w;
+	for (; i + 4 <= n; i += 4)
+	{
+		w = _mm256_or_si256(_mm256_srl_epi64(_mm256_loadu_si256((__m256i*)(p + i)), cs), _mm256_sll_epi64(_mm256_loadu_si256((__m256i*)(p + i + 1)), cc));
+		w = _mm256_or_si256(w, _mm256_sll_epi64(_mm256_loadu_si256((__m256i*)(m + i)), cs));
+		w = _mm256_or_si256(w, _mm256_srl_epi64(_mm256_loadu_si256((__m256i*)(m + i - 1)), cc));
+		if (base != NULL) w = _mm256_or_si256(w, _mm256_loadu_si256((__m256i*)(base + i)));
+		_mm256_storeu_si256((__m256i*)(dst + i), w);
+	}
+#endif
+	for (; i < n; i++)
+	{
+		v = (s == 0) ? p[i] | m[i] : (p[i] >> s) | (p[i + 1] << (64 - s)) | (m[i] << s) | (m[i - 1] >> (64 - s));
+		dst[i] = (base != NULL) ? base[i] | v : v;
+	}
+}
+
+// dst = OR de src[0..nsrc-1], n palavras, numa só passagem por dst
+static void vc_bits_or_gather(unsigned long long* dst, int n, unsigned long long** src, int nsrc)
+{
+	unsigned long long v;
+	int i = 0, k;
+
+#if defined(VC_AVX2)
+	__m256i acc;
+	for (; i + 4 <= n; i += 4)
+	{
+		acc = _mm256_setzero_si256();
+		for (k = 0; k < nsrc; k++) acc = _mm256_or_si256(acc, _mm256_loadu_si256((__m256i*)(src[k] + i)));
+		_mm256_storeu_si256((__m256i*)(dst + i), acc);
+	}
+#endif
+	for (; i < n; i++)
+	{
+		for (k = 0, v = 0; k < nsrc; k++) v |= src[k][i];
+		dst[i] = v;
+	}
+}
+
+// Kernel de uma passagem para elementos até N x N: dst(p) = OR de src(p + q), para os q com off[q] != 0.
+// As linhas da vizinhança são primeiro combinadas por OR, uma vez por cada padrão de coluna distinto do
+// elemento (numa cruz, a coluna central e a linha central), e cada coluna aplica depois um único
+// deslocamento ao seu padrão. N é constante, pelo que os ciclos sobre o elemento são desenrolados.
+#define VC_BITMASK_SE_SMALL_IMPL(name, N) \
+static int name(BVC* src, BVC* dst, unsigned char off[N][N]) \
+{ \
+	int wpl = src->wordsperline; \
+	unsigned long long last = vc_bitmask_lastword(src->width); \
+	unsigned long long *buf, *col, *out; \
+	int pattern[N], pat[N], npat = 0, y, dy, dx, p, yy, first; \
+ \
+	/* Padrão de cada coluna (bit dy ativo se off[dy][dx]) e padrões distintos */ \
+	for (dx = 0; dx < (N); dx++) \
+	{ \
+		for (dy = 0, p = 0; dy < (N); dy++) p |= off[dy][dx] << dy; \
+		for (pat[dx] = 0; (pat[dx] < npat) && (pattern[pat[dx]] != p); pat[dx]++); \
+		if ((p != 0) && (pat[dx] == npat)) pattern[npat++] = p; \
+		if (p == 0) pat[dx] = -1; \
+	} \
+ \
+	/* Um buffer por padrão, com uma palavra a 0 em cada extremo */ \
+	buf = (unsigned long long*)calloc((size_t)(N) * (wpl + 2), sizeof(unsigned long long)); \
+	if (buf == NULL) return 0; \
+ \
+	for (y = 0; y < src->height; y++) \
+	{ \
+		for (p = 0; p < npat; p++) \
+		{ \
+			col = buf + (long int)p * (wpl + 2) + 1; \
+			for (dy = 0, first = 1; dy < (N); dy++) \
+			{ \
+				yy = y + dy - (N) / 2; \
+				if (!((pattern[p] >> dy) & 1) || (yy < 0) || (yy >= src->height)) continue; \
+				if (first) memcpy(col, src->data + (long int)yy * wpl, (size_t)wpl * sizeof(unsigned long long)); \
+				else vc_bits_or_words(col, src->data + (long int)yy * wpl, wpl); \
+				first = 0; \
+			} \
+			if (first) memset(col, 0, (size_t)wpl * sizeof(unsigned long long)); \
+		} \
+ \
+		out = dst->data + (long int)y * wpl; \
+		for (dx = 0, first = 1; dx < (N); dx++) \
+		{ \
+			if (pat[dx] < 0) continue; \
+			vc_bits_offset(out, first ? NULL : out, buf + (long int)pat[dx] * (wpl + 2) + 1, wpl, dx - (N) / 2); \
+			first = 0; \
+		} \
+		if (first) memset(out, 0, (size_t)wpl * sizeof(unsigned long long)); \
+		out[wpl - 1] &= last; \
+	} \
+ \
+	free(buf); \
+ \
+	return 1; \
+}
+
+VC_BITMASK_SE_SMALL_IMPL(vc_bitmask_se_3x3, 3)
+VC_BITMASK_SE_SMALL_IMPL(vc_bitmask_se_5x5, 5)
+
+// Deslocamento q = (x, y) do ponto (col, lin) do elemento; com reflect, q = -(ponto - centro)
+#define VC_SE_AT(se, col, lin, reflect) \
+	((reflect) ? (se)->data[((se)->height - 1 - (lin)) * (se)->width + ((se)->width - 1 - (col))] : (se)->data[(lin) * (se)->width + (col)])
+
+// dst(p) = OR de src(p + q) para os pontos q do elemento (refletido se reflect != 0). dst != src.
+static int vc_bitmask_or_se(BVC* src, BVC* dst, EVC* se, int reflect)
+{
+	int wpl = src->wordsperline;
+	int rx = se->width / 2, ry = se->height / 2;
+	int x, y, yy, lin, col, a, len, c, h, k, n, slot, nseg, npair, guard, nbody, off, sw, ok, centered, full = 1;
+	int *seg, *pair;
+	unsigned long long *ring, *ext, *cur, *out, *tmp, **rows;
+
+	for (x = 0; x < se->width * se->height; x++) full = full && se->data[x];
+
+	// Retângulo: passagem separável
+	if (full)
+	{
+		memcpy(dst->data, src->data, (size_t)wpl * src->height * sizeof(unsigned long long));
+		vc_bitmask_dilate_inplace(dst, rx, ry);
+		return 1;
+	}
+
+	// Elementos pequenos: kernel de uma passagem
+	if ((se->width <= 5) && (se->height <= 5))
+	{
+		unsigned char off3[3][3] = { { 0 } }, off5[5][5] = { { 0 } };
+		n = ((se->width <= 3) && (se->height <= 3)) ? 3 : 5;
+
+		for (lin = 0; lin < se->height; lin++)
+		{
+			for (col = 0; col < se->width; col++)
+			{
+				if (!VC_SE_AT(se, col, lin, reflect)) continue;
+				if (n == 3) off3[lin - ry + 1][col - rx + 1] = 1;
+				else off5[lin - ry + 2][col - rx + 2] = 1;
+			}
+		}
+		return (n == 3) ? vc_bitmask_se_3x3(src, dst, off3) : vc_bitmask_se_5x5(src, dst, off5);
+	}
+
+	// Caso geral: segmentos horizontais das linhas do elemento. Cada par distinto (comprimento,
+	// deslocamento horizontal do último pixel) fica em pair[2p..2p+1], por comprimento crescente
+	// (num disco, as linhas dy e -dy partilham o par); seg[2k..2k+1] = par e deslocamento vertical
+	n = (se->width / 2 + 1) * se->height;
+	seg = (int*)malloc((size_t)2 * n * sizeof(int));
+	pair = (int*)malloc((size_t)2 * n * sizeof(int));
+	rows = (unsigned long long**)malloc((size_t)n * sizeof(unsigned long long*));
+	ok = (seg != NULL) && (pair != NULL) && (rows != NULL);
+	for (len = 1, nseg = 0, npair = 0; ok && (len <= se->width); len++)
+	{
+		for (lin = 0; lin < se->height; lin++)
+		{
+			for (col = 0; col < se->width;)
+			{
+				if (!VC_SE_AT(se, col, lin, reflect))
+				{
+					col++;
+					continue;
+				}
+				for (a = col; (col < se->width) && VC_SE_AT(se, col, lin, reflect); col++);
+				if (col - a != len) continue;
+				for (k = npair - 1; (k >= 0) && (pair[2 * k] == len) && (pair[2 * k + 1] != col - 1 - rx); k--);
+				if ((k < 0) || (pair[2 * k] != len))
+				{
+					k = npair++;
+					pair[2 * k] = len;
+					pair[2 * k + 1] = col - 1 - rx;
+				}
+				seg[2 * nseg] = k;
+				seg[2 * nseg + 1] = lin - ry;
+				nseg++;
+			}
+		}
+	}
+
+	// Elemento simétrico em cada linha (disco, cruz, ...): todos os segmentos centrados em x, len = 2h + 1
+	for (k = 0, centered = ok; centered && (k < npair); k++) centered = (pair[2 * k] % 2 == 1) && (pair[2 * k + 1] == pair[2 * k] / 2);
+
+	// ring: R_len(x + qx) de cada par, com R_len(x) = OR de src(x-len+1..x), já alinhado com dst, para as
+	// height linhas de src na janela vertical do elemento (linhas de sw palavras, a coluna 0 em off).
+	// Com segmentos centrados, R_len(x + h) = C_h(x) = OR de src(x-h..x+h) é calculado no próprio anel a partir
+	// do par anterior, C_(h+d)(x) = C_h(x - d) | C_h(x + d) com d <= h, em guard palavras de cada lado (além
+	// delas C é 0, porque h <= rx). Nos restantes, ext tem duas linhas para a extensão para a esquerda, com
+	// guard palavras a 0 de cada lado e nbody palavras com a linha e mais width - 1 colunas à direita, onde
+	// ainda pode ser lida, e cada par é deslocado de qx para o anel
+	if (centered)
+	{
+		guard = rx / 64 + 1;
+		off = 2 * guard + 1;
+		sw = wpl + 2 * off;
+		nbody = sw;
+	}
+	else
+	{
+		guard = se->width / 64 + 2;
+		off = 0;
+		sw = wpl;
+		nbody = (src->width + se->width - 1 + 63) / 64 + 1;
+	}
+	ring = ok ? (unsigned long long*)calloc((size_t)sw * se->height * npair + 3 * ((size_t)nbody + 2 * guard), sizeof(unsigned long long)) : NULL;
+	if (ring == NULL)
+	{
+		free(seg);
+		free(pair);
+		free(rows);
+		return 0;
+	}
+	ext = ring + (long int)sw * se->height * npair + guard;
+	if (centered) ext += off - guard;
+
+	for (y = -ry; y < src->height; y++)
+	{
+		// Pares da linha y + ry, que entra na janela
+		yy = y + ry;
+		if (yy < src->height)
+		{
+			slot = yy % se->height;
+			cur = ext;
+			memcpy(cur, src->data + (long int)yy * wpl, (size_t)wpl * sizeof(unsigned long long));
+			for (k = 0, c = centered ? 0 : 1; k < npair; k++)
+			{
+				out = ring + (long int)sw * (slot * npair + k) + off;
+				if (centered)
+				{
+					// Por duplicação a partir do par anterior, a última passagem já no anel
+					h = pair[2 * k] / 2;
+					if (h == 0) memcpy(out, cur, (size_t)wpl * sizeof(unsigned long long));
+					while (c < h)
+					{
+						x = (c == 0) ? 1 : MIN(h - c, c);
+						tmp = (c + x == h) ? out : (cur == ext + nbody + 2 * guard) ? ext + 2 * (nbody + 2 * guard) : ext + nbody + 2 * guard;
+						vc_bits_spread(tmp - guard, (c == 0) ? cur - guard : NULL, cur - guard, wpl + 2 * guard, x);
+						cur = tmp;
+						c += x;
+					}
+					cur = out;
+					continue;
+				}
+
+				// Por duplicação até ao comprimento do par (uma passagem se não mais do que duplicar)
+				while (c < pair[2 * k])
+				{
+					x = MIN(pair[2 * k] - c, c);
+					tmp = (cur == ext + nbody + 2 * guard) ? ext + 2 * (nbody + 2 * guard) : ext + nbody + 2 * guard;
+					vc_bits_offset(tmp, cur, cur, nbody, -x);
+					cur = tmp;
+					c += x;
+				}
+				vc_bits_offset(out, NULL, cur, wpl, pair[2 * k + 1]);
+			}
+		}
+		if (y < 0) continue;
+
+		// dst(x, y) = OR de R_len(x + qx, y + qy), numa só passagem pela linha (a posição no anel da linha
+		// y + qy é a da linha y mais qy, dando a volta)
+		c = y % se->height;
+		for (k = 0, n = 0; k < nseg; k++)
+		{
+			yy = y + seg[2 * k + 1];
+			if ((yy < 0) || (yy >= src->height)) continue;
+			slot = c + seg[2 * k + 1];
+			if (slot < 0) slot += se->height;
+			else if (slot >= se->height) slot -= se->height;
+			rows[n++] = ring + (long int)sw * (slot * npair + seg[2 * k]) + off;
+		}
+		vc_bits_or_gather(dst->data + (long int)y * wpl, wpl, rows, n);
+
+		// Os deslocamentos para a direita podem ter ativado bits além de width
+		dst->data[(long int)y * wpl + wpl - 1] &= vc_bitmask_lastword(src->width);
+	}
+
+	free(ring);
+	free(seg);
+	free(pair);
+	free(rows);
+
+	return 1;
+}
+
+// Aplica a dilatação (dilate != 0) ou a erosão com um elemento arbitrário; dst pode ser src.
+// Com keepsrc = 0, src pode ser alterada (a erosão complementa-a no próprio lugar, sem cópia)
+static int vc_bitmask_morphology_se(BVC* src, BVC* dst, EVC* se, int dilate, int keepsrc)
+{
+	BVC* in = src;
+	int ok;
+
+	if ((src == NULL) || (dst == NULL) || (se == NULL) || (se->data == NULL)) return 0;
+	if ((src->width != dst->width) || (src->height != dst->height)) return 0;
+	if ((se->width % 2 == 0) || (se->height % 2 == 0)) return 0;
+
+	// vc_bitmask_or_se precisa de uma origem diferente do destino, e a erosão lê o complemento
+	if ((src == dst) || (!dilate && keepsrc))
+	{
+		in = vc_bitmask_new(src->width, src->height);
+		if (in == NULL) return 0;
+		memcpy(in->data, src->data, (size_t)src->wordsperline * src->height * sizeof(unsigned long long));
+	}
+
+	if (dilate)
+	{
+		// (X + B)(p) = OR de X(p - b)
+		ok = vc_bitmask_or_se(in, dst, se, 1);
+	}
+	else
+	{
+		// Erosão = complemento do OR do fundo em p + b (o exterior da imagem não é fundo)
+		vc_bitmask_invert(in);
+		ok = vc_bitmask_or_se(in, dst, se, 0);
+		if (ok) vc_bitmask_invert(dst);
+	}
+
+	if (in != src) vc_bitmask_free(in);
+
+	return ok;
+}
+
+/**
+ * @brief Dilatação de uma máscara de bits com um elemento estruturante arbitrário.
+ * Os vizinhos fora da imagem são ignorados.
+ * @author lugon
+ * @param src Máscara de origem.
+ * @param dst Máscara de destino (pode ser a própria src).
+ * @param se Elemento estruturante.
+ * @return int Retorna 1 se a dilatação foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_bitmask_dilate_se(BVC* src, BVC* dst, EVC* se)
+{
+	return vc_bitmask_morphology_se(src, dst, se, 1, 1);
+}
+
+/**
+ * @brief Erosão de uma máscara de bits com um elemento estruturante arbitrário.
+ * Os vizinhos fora da imagem são ignorados.
+ * @author lugon
+ * @param src Máscara de origem.
+ * @param dst Máscara de destino (pode ser a própria src).
+ * @param se Elemento estruturante.
+ * @return int Retorna 1 se a erosão foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_bitmask_erode_se(BVC* src, BVC* dst, EVC* se)
+{
+	return vc_bitmask_morphology_se(src, dst, se, 0, 1);
+}
+
+// Compacta src, aplica a operação com o elemento e expande para dst (mesmos critérios de frente de vc_binary_dilate/erode)
+static int vc_binary_morphology_se(IVC* src, IVC* dst, EVC* se, int dilate)
+{
+	BVC *mask, *out;
+	int ok;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
+	if ((dst->width != src->width) || (dst->height != src->height) || (dst->data == NULL)) return 0;
+	if ((src->channels != 1) || (dst->channels != 1)) return 0;
+
+	mask = vc_bitmask_new(src->width, src->height);
+	out = vc_bitmask_new(src->width, src->height);
+	ok = (mask != NULL) && (out != NULL);
+
+	if (ok) ok = vc_binary_to_bitmask(src, mask, dilate ? 255 : 1);
+	if (ok) ok = vc_bitmask_morphology_se(mask, out, se, dilate, 0);
+	if (ok) ok = vc_bitmask_to_binary(out, dst);
+
+	vc_bitmask_free(mask);
+	vc_bitmask_free(out);
+
+	return ok;
+}
+
+/**
+ * @brief Dilatação binária com um elemento estruturante arbitrário (disco, cruz, linha, máscara).
+ * @author lugon
+ * @param src Imagem binária de entrada (frente = 255).
+ * @param dst Imagem binária de saída (0/255).
+ * @param se Elemento estruturante.
+ * @return int Retorna 1 se a dilatação foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_binary_dilate_se(IVC* src, IVC* dst, EVC* se)
+{
+	return vc_binary_morphology_se(src, dst, se, 1);
+}
+
+/**
+ * @brief Erosão binária com um elemento estruturante arbitrário (disco, cruz, linha, máscara).
+ * @author lugon
+ * @param src Imagem binária de entrada (fundo = 0).
+ * @param dst Imagem binária de saída (0/255).
+ * @param se Elemento estruturante.
+ * @return int Retorna 1 se a erosão foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_binary_erode_se(IVC* src, IVC* dst, EVC* se)
+{
+	return vc_binary_morphology_se(src, dst, se, 0);
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//         FUNÇÕES: TRANSFORMADA DE DISTÂNCIA EUCLIDIANA
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Transformada exata em tempo linear (Meijster et al.): uma passagem por colunas dá a distância vertical
+// ao pixel de referência mais próximo e uma passagem por linhas calcula o envelope inferior das parábolas
+// (x - i)^2 + g(i)^2. As colunas são independentes (processadas em blocos de 64, pelas linhas, para
+// aproveitar a cache) e as linhas também, pelo que ambas as fases são paralelizadas com OpenMP
+// (/openmp no MSVC, -fopenmp no GCC); sem OpenMP os pragmas são ignorados.
+// Os pixels fora da imagem não são pixels de referência.
+
+// Separação de Meijster: primeira coluna a partir da qual a parábola de u fica abaixo da de i (i < u)
+static int vc_edt_sep(int i, int u, int gi2, int gu2)
+{
+	int num = u * u - i * i + gu2 - gi2, den = 2 * (u - i);
+
+	return (num >= 0) ? num / den : -((-num + den - 1) / den);
+}
+
+// d2[y * width + x] = quadrado da distância ao pixel de nível value mais próximo.
+// Se não houver nenhum, fica >= (width + height)^2. Os valores cabem em 32 bits até imagens de ~16000 x 16000.
+static int vc_binary_edt_squared(IVC* src, unsigned char value, int* d2)
+{
+	int width = src->width, height = src->height;
+	int inf = width + height;
+	int nblocks = (height + 31) / 32, ok = 1, b;
+
+	// Fase 1: distância vertical g, em blocos de 64 colunas
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for (b = 0; b < (width + 63) / 64; b++)
+	{
+		int x0 = b * 64, x1 = MIN(x0 + 64, width), x, y;
+		unsigned char* line;
+		int* g;
+
+		for (x = x0; x < x1; x++) d2[x] = (src->data[x] == value) ? 0 : inf;
+		for (y = 1; y < height; y++)
+		{
+			g = d2 + (long int)y * width;
+			line = src->data + (long int)y * src->bytesperline;
+			for (x = x0; x < x1; x++) g[x] = (line[x] == value) ? 0 : MIN(g[x - width] + 1, inf);
+		}
+		for (y = height - 2; y >= 0; y--)
+		{
+			g = d2 + (long int)y * width;
+			for (x = x0; x < x1; x++) g[x] = MIN(g[x], g[x + width] + 1);
+		}
+	}
+
+	// Fase 2: envelope inferior das parábolas em cada linha, em blocos de 32 linhas
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for (b = 0; b < nblocks; b++)
+	{
+		int* g2 = (int*)malloc((size_t)width * sizeof(int));
+		int* sv = (int*)malloc((size_t)width * sizeof(int));
+		int* tv = (int*)malloc((size_t)width * sizeof(int));
+		int y, u, q, w, *row;
+
+		if ((g2 == NULL) || (sv == NULL) || (tv == NULL))
+		{
+			ok = 0;
+		}
+		else
+		{
+			for (y = b * 32; y < MIN(b * 32 + 32, height); y++)
+			{
+				row = d2 + (long int)y * width;
+				for (u = 0; u < width; u++) g2[u] = row[u] * row[u];
+
+				// sv[0..q] = colunas das parábolas do envelope; tv[k] = primeira coluna onde sv[k] é mínima
+				q = 0;
+				sv[0] = 0;
+				tv[0] = 0;
+				for (u = 1; u < width; u++)
+				{
+					while ((q >= 0) && ((tv[q] - sv[q]) * (tv[q] - sv[q]) + g2[sv[q]] > (tv[q] - u) * (tv[q] - u) + g2[u])) q--;
+					if (q < 0)
+					{
+						q = 0;
+						sv[0] = u;
+					}
+					else
+					{
+						w = 1 + vc_edt_sep(sv[q], u, g2[sv[q]], g2[u]);
+						if (w < width)
+						{
+							q++;
+							sv[q] = u;
+							tv[q] = w;
+						}
+					}
+				}
+				for (u = width - 1; u >= 0; u--)
+				{
+					row[u] = (u - sv[q]) * (u - sv[q]) + g2[sv[q]];
+					if (u == tv[q]) q--;
+				}
+			}
+		}
+
+		free(g2);
+		free(sv);
+		free(tv);
+	}
+
+	return ok;
+}
+
+// Valida uma imagem binária de 1 canal e calcula o quadrado da transformada em relação aos pixels de fundo (0)
+static int* vc_binary_edt_background(IVC* src)
+{
+	int* d2;
+
+	if ((src == NULL) || (src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return NULL;
+	if (src->channels != 1) return NULL;
+
+	d2 = (int*)malloc((size_t)src->width * src->height * sizeof(int));
+	if (d2 == NULL) return NULL;
+
+	if (!vc_binary_edt_squared(src, 0, d2))
+	{
+		free(d2);
+		return NULL;
+	}
+
+	return d2;
+}
+
+/**
+ * @brief Transformada de distância euclidiana exata: distância de cada pixel de frente (!= 0)
+ * ao pixel de fundo (0) mais próximo. Os pixels de fundo ficam a 0.
+ * @author lugon
+ * @param src Imagem binária de entrada (1 canal).
+ * @param dist Distâncias, width x height (alocado pelo chamador); -1 se a imagem não tiver fundo.
+ * @return int Retorna 1 se a transformada foi calculada com sucesso, 0 se houve um erro.
+ */
+int vc_binary_distance_transform(IVC* src, float* dist)
+{
+	int* d2;
+	long int i, n;
+	int inf;
+
+	if (dist == NULL) return 0;
+
+	d2 = vc_binary_edt_background(src);
+	if (d2 == NULL) return 0;
+
+	inf = src->width + src->height;
+	n = (long int)src->width * src->height;
+	for (i = 0; i < n; i++) dist[i] = (d2[i] >= inf * inf) ? -1.0f : sqrtf((float)d2[i]);
+
+	free(d2);
+
+	return 1;
+}
+
+/**
+ * @brief Transformada de distância euclidiana exata com saída de 16 bits: distância arredondada
+ * ao inteiro mais próximo, de cada pixel de frente (!= 0) ao pixel de fundo (0) mais próximo.
+ * @author lugon
+ * @param src Imagem binária de entrada (1 canal).
+ * @param dist Distâncias, width x height (alocado pelo chamador); 65535 se a imagem não tiver fundo.
+ * @return int Retorna 1 se a transformada foi calculada com sucesso, 0 se houve um erro.
+ */
+int vc_binary_distance_transform_u16(IVC* src, unsigned short* dist)
+{
+	int* d2;
+	long int i, n;
+	int inf;
+
+	if (dist == NULL) return 0;
+
+	d2 = vc_binary_edt_background(src);
+	if (d2 == NULL) return 0;
+
+	inf = src->width + src->height;
+	n = (long int)src->width * src->height;
+	for (i = 0; i < n; i++) dist[i] = (d2[i] >= inf * inf) ? 65535 : (unsigned short)MIN((int)(sqrtf((float)d2[i]) + 0.5f), 65535);
+
+	free(d2);
+
+	return 1;
+}
+
+// Dilatação (dilate != 0) ou erosão por um disco de raio radius (pontos com x^2 + y^2 <= radius^2),
+// como threshold da transformada de distância
+static int vc_binary_morphology_radius(IVC* src, IVC* dst, float radius, int dilate)
+{
+	int* d2;
+	long long limit;
+	long int i, n;
+	int x, y;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
+	if ((dst->width != src->width) || (dst->height != src->height) || (dst->data == NULL)) return 0;
+	if ((src->channels != 1) || (dst->channels != 1)) return 0;
+	if (radius < 0.0f) return 0;
+
+	// Nenhuma distância real chega a width + height
+	radius = MIN(radius, (float)(src->width + src->height - 1));
+	limit = (long long)floor((double)radius * radius);
+
+	n = (long int)src->width * src->height;
+	d2 = (int*)malloc((size_t)n * sizeof(int));
+	if (d2 == NULL) return 0;
+
+	// Dilatação: distância à frente (255); erosão: distância ao fundo (0)
+	if (!vc_binary_edt_squared(src, dilate ? 255 : 0, d2))
+	{
+		free(d2);
+		return 0;
+	}
+
+	for (y = 0; y < src->height; y++)
+	{
+		for (x = 0; x < src->width; x++)
+		{
+			i = (long int)y * src->width + x;
+			if (dilate) dst->data[(long int)y * dst->bytesperline + x] = (d2[i] <= limit) ? 255 : 0;
+			else dst->data[(long int)y * dst->bytesperline + x] = (d2[i] > limit) ? 255 : 0;
+		}
+	}
+
+	free(d2);
+
+	return 1;
+}
+
+/**
+ * @brief Dilatação binária por um disco de raio qualquer, em tempo linear independente do raio.
+ * Equivalente a vc_binary_dilate_se com vc_se_disk(radius) para raios inteiros.
+ * @author lugon
+ * @param src Imagem binária de entrada (frente = 255).
+ * @param dst Imagem binária de saída (0/255).
+ * @param radius Raio do disco, em pixels (pode ser fracionário).
+ * @return int Retorna 1 se a dilatação foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_binary_dilate_radius(IVC* src, IVC* dst, float radius)
+{
+	return vc_binary_morphology_radius(src, dst, radius, 1);
+}
+
+/**
+ * @brief Erosão binária por um disco de raio qualquer, em tempo linear independente do raio.
+ * Equivalente a vc_binary_erode_se com vc_se_disk(radius) para raios inteiros.
+ * @author lugon
+ * @param src Imagem binária de entrada (fundo = 0).
+ * @param dst Imagem binária de saída (0/255).
+ * @param radius Raio do disco, em pixels (pode ser fracionário).
+ * @return int Retorna 1 se a erosão foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_binary_erode_radius(IVC* src, IVC* dst, float radius)
+{
+	return vc_binary_morphology_radius(src, dst, radius, 0);
+}
+
+/**
+ * @brief Espessura de cada blob a partir do eixo medial da transformada de distância.
+ * Um pixel pertence ao eixo medial se a sua distância ao fundo não é menor do que a de nenhum dos
+ * 8 vizinhos do mesmo blob; a espessura nesse ponto é 2 * d - 1 pixels (1 para uma linha de um pixel).
+ * @author lugon
+ * @param labels Imagem de etiquetas (resultado de vc_binary_blob_labelling).
+ * @param blobs Blobs a medir.
+ * @param nblobs Número de blobs.
+ * @param maxthickness Espessura máxima de cada blob (nblobs entradas; pode ser NULL).
+ * @param meanthickness Espessura média ao longo do eixo medial de cada blob (nblobs entradas; pode ser NULL).
+ * @return int Retorna 1 se a medição foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_binary_blob_thickness(IVC* labels, OVC* blobs, int nblobs, float* maxthickness, float* meanthickness)
+{
+	int index[256];
+	int* d2;
+	int* count;
+	float* sum;
+	float* peak;
+	int width, height, x, y, dx, dy, i, ridge;
+	unsigned char lab;
+	long int pos;
+
+	if ((blobs == NULL) || (nblobs < 0)) return 0;
+
+	d2 = vc_binary_edt_background(labels);
+	if (d2 == NULL) return 0;
+
+	width = labels->width;
+	height = labels->height;
+
+	count = (int*)calloc((size_t)nblobs + 1, sizeof(int));
+	sum = (float*)calloc((size_t)nblobs + 1, sizeof(float));
+	peak = (float*)calloc((size_t)nblobs + 1, sizeof(float));
+	if ((count == NULL) || (sum == NULL) || (peak == NULL))
+	{
+		free(d2);
+		free(count);
+		free(sum);
+		free(peak);
+		return 0;
+	}
+
+	// Etiqueta -> índice em blobs[] (-1 se a etiqueta não foi pedida)
+	for (i = 0; i < 256; i++) index[i] = -1;
+	for (i = 0; i < nblobs; i++)
+	{
+		if ((blobs[i].label > 0) && (blobs[i].label < 256)) index[blobs[i].label] = i;
+	}
+
+	for (y = 0; y < height; y++)
+	{
+		for (x = 0; x < width; x++)
+		{
+			lab = labels->data[(long int)y * labels->bytesperline + x];
+			if ((lab == 0) || (index[lab] < 0)) continue;
+
+			pos = (long int)y * width + x;
+
+			// Máximo local da distância entre os vizinhos do mesmo blob
+			ridge = 1;
+			for (dy = -1; (dy <= 1) && ridge; dy++)
+			{
+				for (dx = -1; (dx <= 1) && ridge; dx++)
+				{
+					if ((y + dy < 0) || (y + dy >= height) || (x + dx < 0) || (x + dx >= width)) continue;
+					if (labels->data[(long int)(y + dy) * labels->bytesperline + x + dx] != lab) continue;
+					if (d2[pos + (long int)dy * width + dx] > d2[pos]) ridge = 0;
+				}
+			}
+			if (!ridge) continue;
+
+			i = index[lab];
+			count[i]++;
+			sum[i] += 2.0f * sqrtf((float)d2[pos]) - 1.0f;
+			peak[i] = MAX(peak[i], 2.0f * sqrtf((float)d2[pos]) - 1.0f);
+		}
+	}
+
+	for (i = 0; i < nblobs; i++)
+	{
+		if (maxthickness != NULL) maxthickness[i] = peak[i];
+		if (meanthickness != NULL) meanthickness[i] = (count[i] > 0) ? sum[i] / (float)count[i] : 0.0f;
+	}
+
+	free(d2);
+	free(count);
+	free(sum);
+	free(peak);
+
+	return 1;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//          FUNÇÕES: MORFOLOGIA EM ESCALA DE CINZA
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Erosão e dilatação com um quadrado kernel x kernel são o mínimo e o máximo locais
+// (vc_gray_min_max_filter), com custo por pixel independente do kernel. A abertura remove picos
+// claros mais pequenos do que o kernel (reflexos); o top-hat branco (src - abertura) isola-os e o
+// preto (fecho - src) isola os detalhes escuros, ambos sobre um fundo achatado.
+
+/**
+ * @brief Erosão em escala de cinza (mínimo local numa janela kernel x kernel).
+ * @author lugon
+ * @param src Imagem de origem em escala de cinza.
+ * @param dst Imagem de destino (pode ser a própria src).
+ * @param kernel Tamanho do kernel.
+ * @return int Retorna 1 se a erosão foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_gray_erode(IVC* src, IVC* dst, int kernel)
+{
+	return vc_gray_min_max_filter(src, dst, NULL, kernel);
+}
+
+/**
+ * @brief Dilatação em escala de cinza (máximo local numa janela kernel x kernel).
+ * @author lugon
+ * @param src Imagem de origem em escala de cinza.
+ * @param dst Imagem de destino (pode ser a própria src).
+ * @param kernel Tamanho do kernel.
+ * @return int Retorna 1 se a dilatação foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_gray_dilate(IVC* src, IVC* dst, int kernel)
+{
+	return vc_gray_min_max_filter(src, NULL, dst, kernel);
+}
+
+/**
+ * @brief Abertura em escala de cinza: erosão seguida de dilatação.
+ * @author lugon
+ * @param src Imagem de origem em escala de cinza.
+ * @param dst Imagem de destino (pode ser a própria src).
+ * @param kernel Tamanho do kernel.
+ * @return int Retorna 1 se a abertura foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_gray_open(IVC* src, IVC* dst, int kernel)
+{
+	if (!vc_gray_min_max_filter(src, dst, NULL, kernel)) return 0;
+
+	return vc_gray_min_max_filter(dst, NULL, dst, kernel);
+}
+
+/**
+ * @brief Fecho em escala de cinza: dilatação seguida de erosão.
+ * @author lugon
+ * @param src Imagem de origem em escala de cinza.
+ * @param dst Imagem de destino (pode ser a própria src).
+ * @param kernel Tamanho do kernel.
+ * @return int Retorna 1 se o fecho foi bem-sucedido, 0 se houve um erro.
+ */
+int vc_gray_close(IVC* src, IVC* dst, int kernel)
+{
+	if (!vc_gray_min_max_filter(src, NULL, dst, kernel)) return 0;
+
+	return vc_gray_min_max_filter(dst, dst, NULL, kernel);
+}
+
+// Top-hat branco (white != 0: src - abertura) ou preto (fecho - src); ambos são >= 0 por construção
+static int vc_gray_tophat(IVC* src, IVC* dst, int kernel, int white)
+{
+	IVC* tmp;
+	long int i, size;
+	int ok;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
+	if ((dst->width != src->width) || (dst->height != src->height) || (dst->data == NULL)) return 0;
+	if ((src->channels != 1) || (dst->channels != 1)) return 0;
+
+	tmp = vc_image_new(src->width, src->height, 1, 255);
+	if (tmp == NULL) return 0;
+
+	ok = white ? vc_gray_open(src, tmp, kernel) : vc_gray_close(src, tmp, kernel);
+
+	if (ok)
+	{
+		size = (long int)src->width * src->height;
+		if (white)
+		{
+			for (i = 0; i < size; i++) dst->data[i] = src->data[i] - tmp->data[i];
+		}
+		else
+		{
+			for (i = 0; i < size; i++) dst->data[i] = tmp->data[i] - src->data[i];
+		}
+	}
+
+	vc_image_free(tmp);
+
+	return ok;
+}
+
+/**
+ * @brief Top-hat branco: src - abertura(src). Realça detalhes claros menores do que o kernel
+ * (reflexos, marcas) e remove variações lentas de iluminação.
+ * @author lugon
+ * @param src Imagem de origem em escala de cinza.
+ * @param dst Imagem de destino (pode ser a própria src).
+ * @param kernel Tamanho do kernel (maior do que os detalhes a realçar).
+ * @return int Retorna 1 se a operação foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_gray_tophat_white(IVC* src, IVC* dst, int kernel)
+{
+	return vc_gray_tophat(src, dst, kernel, 1);
+}
+
+/**
+ * @brief Top-hat preto: fecho(src) - src. Realça detalhes escuros menores do que o kernel
+ * sobre um fundo de iluminação irregular.
+ * @author lugon
+ * @param src Imagem de origem em escala de cinza.
+ * @param dst Imagem de destino (pode ser a própria src).
+ * @param kernel Tamanho do kernel (maior do que os detalhes a realçar).
+ * @return int Retorna 1 se a operação foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_gray_tophat_black(IVC* src, IVC* dst, int kernel)
+{
+	return vc_gray_tophat(src, dst, kernel, 0);
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//   FUNÇÕES: RECONSTRUÇÃO MORFOLÓGICA E PREENCHIMENTO DE BURACOS
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Reconstrução por dilatação (algoritmo híbrido de Vincent): a marca é dilatada repetidamente dentro da
+// máscara até estabilizar. Uma passagem raster direta e uma inversa propagam a maior parte dos valores;
+// os pixels que ainda podem propagar ficam numa fila FIFO, que é esvaziada no fim. Cada pixel entra na
+// fila poucas vezes, pelo que o custo é quase linear, independente da distância de propagação.
+
+// Fila FIFO de posições, que cresce quando necessário
+typedef struct {
+	int* data;
+	int capacity, head, tail;
+} vc_fifo;
+
+static int vc_fifo_push(vc_fifo* fifo, int value)
+{
+	int* data;
+
+	if (fifo->tail == fifo->capacity)
+	{
+		if (fifo->head > 0)
+		{
+			// Reaproveita o espaço dos elementos já retirados
+			memmove(fifo->data, fifo->data + fifo->head, (size_t)(fifo->tail - fifo->head) * sizeof(int));
+			fifo->tail -= fifo->head;
+			fifo->head = 0;
+		}
+		else
+		{
+			data = (int*)realloc(fifo->data, (size_t)fifo->capacity * 2 * sizeof(int));
+			if (data == NULL) return 0;
+			fifo->data = data;
+			fifo->capacity *= 2;
+		}
+	}
+
+	fifo->data[fifo->tail++] = value;
+
+	return 1;
+}
+
+// Reconstrução de J (marca, já limitada por I) dentro de I, no próprio lugar, com vizinhança 4 ou 8
+static int vc_reconstruct_dilate(unsigned char* J, unsigned char* I, int width, int height, int connectivity)
+{
+	// Vizinhos anteriores na ordem raster (N+); os posteriores (N-) são os simétricos
+	static const int dx8[4] = { -1, -1, 0, 1 }, dy8[4] = { 0, -1, -1, -1 };
+	static const int dx4[2] = { -1, 0 }, dy4[2] = { 0, -1 };
+	const int* dx = (connectivity == 4) ? dx4 : dx8;
+	const int* dy = (connectivity == 4) ? dy4 : dy8;
+	int n = (connectivity == 4) ? 2 : 4;
+	int x, y, xx, yy, k, p, q, m, ok = 1;
+	vc_fifo fifo;
+
+	fifo.capacity = MAX(width + height, 64);
+	fifo.head = 0;
+	fifo.tail = 0;
+	fifo.data = (int*)malloc((size_t)fifo.capacity * sizeof(int));
+	if (fifo.data == NULL) return 0;
+
+	// Passagem direta
+	for (y = 0; y < height; y++)
+	{
+		for (x = 0; x < width; x++)
+		{
+			p = y * width + x;
+			m = J[p];
+			for (k = 0; k < n; k++)
+			{
+				xx = x + dx[k];
+				yy = y + dy[k];
+				if ((xx >= 0) && (xx < width) && (yy >= 0)) m = MAX(m, J[yy * width + xx]);
+			}
+			J[p] = (unsigned char)MIN(m, I[p]);
+		}
+	}
+
+	// Passagem inversa; os pixels que ainda podem propagar para um vizinho posterior vão para a fila
+	for (y = height - 1; y >= 0; y--)
+	{
+		for (x = width - 1; x >= 0; x--)
+		{
+			p = y * width + x;
+			m = J[p];
+			for (k = 0; k < n; k++)
+			{
+				xx = x - dx[k];
+				yy = y - dy[k];
+				if ((xx >= 0) && (xx < width) && (yy < height)) m = MAX(m, J[yy * width + xx]);
+			}
+			J[p] = (unsigned char)MIN(m, I[p]);
+
+			for (k = 0; k < n; k++)
+			{
+				xx = x - dx[k];
+				yy = y - dy[k];
+				if ((xx < 0) || (xx >= width) || (yy >= height)) continue;
+				q = yy * width + xx;
+				if ((J[q] < J[p]) && (J[q] < I[q]))
+				{
+					ok = ok && vc_fifo_push(&fifo, p);
+					break;
+				}
+			}
+		}
+	}
+
+	// Propagação pela fila, com a vizinhança completa
+	while (ok && (fifo.head < fifo.tail))
+	{
+		p = fifo.data[fifo.head++];
+		x = p % width;
+		y = p / width;
+
+		for (k = 0; k < 2 * n; k++)
+		{
+			xx = (k < n) ? x + dx[k] : x - dx[k - n];
+			yy = (k < n) ? y + dy[k] : y - dy[k - n];
+			if ((xx < 0) || (xx >= width) || (yy < 0) || (yy >= height)) continue;
+			q = yy * width + xx;
+			if ((J[q] < J[p]) && (I[q] != J[q]))
+			{
+				J[q] = (unsigned char)MIN(J[p], I[q]);
+				ok = ok && vc_fifo_push(&fifo, q);
+			}
+		}
+	}
+
+	free(fifo.data);
+
+	return ok;
+}
+
+/**
+ * @brief Reconstrução morfológica por dilatação em escala de cinza (vizinhança 8): dilata a marca
+ * dentro da máscara até estabilizar. Custo quase linear, qualquer que seja a distância a propagar.
+ * @author lugon
+ * @param marker Imagem marca (os valores acima da máscara são limitados por ela).
+ * @param mask Imagem máscara.
+ * @param dst Imagem de destino (pode ser a marca).
+ * @return int Retorna 1 se a reconstrução foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_gray_reconstruct(IVC* marker, IVC* mask, IVC* dst)
+{
+	long int i, size;
+
+	// Verificação de erros
+	if ((marker->width <= 0) || (marker->height <= 0) || (marker->data == NULL) || (mask->data == NULL) || (dst->data == NULL)) return 0;
+	if ((mask->width != marker->width) || (mask->height != marker->height)) return 0;
+	if ((dst->width != marker->width) || (dst->height != marker->height)) return 0;
+	if ((marker->channels != 1) || (mask->channels != 1) || (dst->channels != 1)) return 0;
+	if (dst == mask) return 0;
+
+	size = (long int)marker->width * marker->height;
+	for (i = 0; i < size; i++) dst->data[i] = MIN(marker->data[i], mask->data[i]);
+
+	return vc_reconstruct_dilate(dst->data, mask->data, marker->width, marker->height, 8);
+}
+
+/**
+ * @brief Reconstrução morfológica binária (vizinhança 8): mantém as componentes da máscara que
+ * contêm pelo menos um pixel da marca. Os pixels diferentes de 0 são frente.
+ * @author lugon
+ * @param marker Imagem binária marca.
+ * @param mask Imagem binária máscara.
+ * @param dst Imagem binária de destino (0/255; pode ser a marca ou a máscara).
+ * @return int Retorna 1 se a reconstrução foi bem-sucedida, 0 se houve um erro.
+ */
+int vc_binary_reconstruct(IVC* marker, IVC* mask, IVC* dst)
+{
+	unsigned char* I;
+	long int i, size;
+	int ok;
+
+	// Verificação de erros
+	if ((marker->width <= 0) || (marker->height <= 0) || (marker->data == NULL) || (mask->data == NULL) || (dst->data == NULL)) return 0;
+	if ((mask->width != marker->width) || (mask->height != marker->height)) return 0;
+	if ((dst->width != marker->width) || (dst->height != marker->height)) return 0;
+	if ((marker->channels != 1) || (mask->channels != 1) || (dst->channels != 1)) return 0;
+
+	size = (long int)marker->width * marker->height;
+	I = (unsigned char*)malloc(size);
+	if (I == NULL) return 0;
+
+	for (i = 0; i < size; i++)
+	{
+		I[i] = mask->data[i] ? 255 : 0;
+		dst->data[i] = (marker->data[i] && I[i]) ? 255 : 0;
+	}
+
+	ok = vc_reconstruct_dilate(dst->data, I, marker->width, marker->height, 8);
+
+	free(I);
+
+	return ok;
+}
+
+/**
+ * @brief Preenche os buracos dos objetos de uma imagem binária: regiões de fundo que não estão
+ * ligadas ao limite da imagem (o fundo usa vizinhança 4, complementar da vizinhança 8 dos objetos).
+ * @author lugon
+ * @param src Imagem binária de entrada (frente != 0).
+ * @param dst Imagem binária de saída (0/255; pode ser a própria src).
+ * @return int Retorna 1 se o preenchimento foi bem-sucedido, 0 se houve um erro.
+ */
+int vc_binary_fill_holes(IVC* src, IVC* dst)
+{
+	unsigned char *I, *J;
+	int width = src->width, height = src->height;
+	int x, y, ok;
+	long int i, size;
+
+	// Verificação de erros
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
+	if ((dst->width != src->width) || (dst->height != src->height) || (dst->data == NULL)) return 0;
+	if ((src->channels != 1) || (dst->channels != 1)) return 0;
+
+	size = (long int)width * height;
+	I = (unsigned char*)malloc(size);
+	J = (unsigned char*)calloc(size, 1);
+	if ((I == NULL) || (J == NULL))
+	{
+		free(I);
+		free(J);
+		return 0;
+	}
+
+	// Máscara = fundo; marca = fundo no limite da imagem
+	for (i = 0; i < size; i++) I[i] = src->data[i] ? 0 : 255;
+	for (x = 0; x < width; x++)
+	{
+		J[x] = I[x];
+		J[(long int)(height - 1) * width + x] = I[(long int)(height - 1) * width + x];
+	}
+	for (y = 0; y < height; y++)
+	{
+		J[(long int)y * width] = I[(long int)y * width];
+		J[(long int)y * width + width - 1] = I[(long int)y * width + width - 1];
+	}
+
+	ok = vc_reconstruct_dilate(J, I, width, height, 4);
+
+	// Tudo o que não é fundo ligado ao limite passa a frente
+	if (ok)
+	{
+		for (i = 0; i < size; i++) dst->data[i] = J[i] ? 0 : 255;
+	}
+
+	free(I);
+	free(J);
+
+	return ok;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//    FUNÇÕES: BORDAS PRÉ-PREENCHIDAS PARA FILTROS DE VIZINHANÇA
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Em vez de testar os limites da imagem em cada vizinho, a imagem é copiada para uma imagem maior,
+// com uma margem de 'border' pixels preenchida uma única vez segundo a política escolhida. Os ciclos
+// interiores dos filtros ficam sem ramificações (e vetorizáveis), e todos os filtros tratam a borda
+// da mesma forma.
+
+// Índice dentro de [0, n) correspondente ao índice i, segundo a política (exceto a constante)
+static int vc_border_index(int i, int n, int policy)
+{
+	if (policy == VC_BORDER_REPLICATE) return MIN(MAX(i, 0), n - 1);
+
+	// Espelho sem repetir a margem, repetido se a margem for maior do que a imagem
+	if (n == 1) return 0;
+	while ((i < 0) || (i >= n))
+	{
+		if (i < 0) i = -i;
+		if (i >= n) i = 2 * n - 2 - i;
+	}
+
+	return i;
+}
+
+/**
+ * @brief Preenche a margem de uma imagem com bordas, a partir do seu interior.
+ * @author lugon
+ * @param image Imagem com (width - 2 * border) x (height - 2 * border) pixels válidos no interior.
+ * @param border Largura da margem, em pixels.
+ * @param policy VC_BORDER_CONSTANT, VC_BORDER_REPLICATE ou VC_BORDER_REFLECT.
+ * @param value Valor da margem para VC_BORDER_CONSTANT.
+ * @return int Retorna 1 se a margem foi preenchida, 0 se houve um erro.
+ */
+int vc_image_fill_border(IVC* image, int border, int policy, unsigned char value)
+{
+	int channels = image->channels;
+	int bpl = image->bytesperline;
+	int w, h, x, y;
+	unsigned char* row;
+
+	// Verificação de erros
+	if ((image->width <= 0) || (image->height <= 0) || (image->data == NULL) || (border < 0)) return 0;
+	if ((policy != VC_BORDER_CONSTANT) && (policy != VC_BORDER_REPLICATE) && (policy != VC_BORDER_REFLECT)) return 0;
+
+	w = image->width - 2 * border;
+	h = image->height - 2 * border;
+	if ((w <= 0) || (h <= 0)) return 0;
+	if (border == 0) return 1;
+
+	// Colunas laterais das linhas interiores
+	for (y = border; y < border + h; y++)
+	{
+		row = image->data + (long int)y * bpl;
+		if (policy == VC_BORDER_CONSTANT)
+		{
+			memset(row, value, (size_t)border * channels);
+			memset(row + (long int)(border + w) * channels, value, (size_t)border * channels);
+		}
+		else
+		{
+			for (x = 0; x < border; x++)
+			{
+				memcpy(row + (long int)x * channels, row + (long int)(border + vc_border_index(x - border, w, policy)) * channels, channels);
+				memcpy(row + (long int)(border + w + x) * channels, row + (long int)(border + vc_border_index(w + x, w, policy)) * channels, channels);
+			}
+		}
+	}
+
+	// Linhas de cima e de baixo, copiadas inteiras (já com as colunas laterais)
+	for (y = 0; y < border; y++)
+	{
+		if (policy == VC_BORDER_CONSTANT)
+		{
+			memset(image->data + (long int)y * bpl, value, bpl);
+			memset(image->data + (long int)(border + h + y) * bpl, value, bpl);
+		}
+		else
+		{
+			memcpy(image->data + (long int)y * bpl, image->data + (long int)(border + vc_border_index(y - border, h, policy)) * bpl, bpl);
+			memcpy(image->data + (long int)(border + h + y) * bpl, image->data + (long int)(border + vc_border_index(h + y, h, policy)) * bpl, bpl);
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * @brief Cria uma cópia da imagem com uma margem de 'border' pixels à volta, preenchida segundo a política.
+ * O pixel (x, y) de src fica em (x + border, y + border).
+ * @author lugon
+ * @param src Imagem de origem.
+ * @param border Largura da margem, em pixels.
+ * @param policy VC_BORDER_CONSTANT, VC_BORDER_REPLICATE ou VC_BORDER_REFLECT.
+ * @param value Valor da margem para VC_BORDER_CONSTANT.
+ * @return IVC* Imagem com (width + 2 * border) x (height + 2 * border) pixels, ou NULL em caso de erro.
+ */
+IVC* vc_image_pad(IVC* src, int border, int policy, unsigned char value)
+{
+	IVC* dst;
+	int y;
+
+	// Verificação de erros
+	if ((src == NULL) || (src->width <= 0) || (src->height <= 0) || (src->data == NULL) || (border < 0)) return NULL;
+
+	dst = vc_image_new(src->width + 2 * border, src->height + 2 * border, src->channels, src->levels);
+	if (dst == NULL) return NULL;
+
+	for (y = 0; y < src->height; y++)
+	{
+		memcpy(dst->data + (long int)(y + border) * dst->bytesperline + (long int)border * src->channels, src->data + (long int)y * src->bytesperline, src->bytesperline);
+	}
+
+	if (!vc_image_fill_border(dst, border, policy, value)) return vc_image_free(dst);
+
+	return dst;
+}
+
+// Validação comum dos filtros com bordas: src e dst em escala de cinza com as mesmas dimensões
+static int vc_gray_filter_check(IVC* src, IVC* dst)
+{
+	if ((src->width <= 0) || (src->height <= 0) || (src->data == NULL)) return 0;
+	if ((src->width != dst->width) || (src->height != dst->height) || (dst->data == NULL)) return 0;
+	if ((src->channels != 1) || (dst->channels != 1)) return 0;
+
+	return 1;
+}
+
+/**
+ * @brief Filtro de média kernel x kernel com a política de borda indicada.
+ * As somas das janelas são obtidas da imagem integral da imagem com bordas, sem cortar a janela.
+ * @author lugon
+ * @param src Imagem de origem em escala de cinza.
+ * @param dst Imagem de destino.
+ * @param kernel Tamanho do kernel.
+ * @param policy VC_BORDER_CONSTANT (0 fora da imagem), VC_BORDER_REPLICATE ou VC_BORDER_REFLECT.
+ * @return int Retorna 1 se o filtro foi processado com sucesso, caso contrário retorna 0.
+ */
+int vc_gray_lowpass_mean_filter_border(IVC* src, IVC* dst, int kernel, int policy)
+{
+	int r = (kernel - 1) / 2;
+	int x, y, w;
+	float area = (float)(kernel * kernel);
+	unsigned int *top, *bottom;
+	IVC* padded;
+	SVC* integral;
+
+	// Verificação de erros
+	if (!vc_gray_filter_check(src, dst) || (kernel < 1)) return 0;
+
+	padded = vc_image_pad(src, r, policy, 0);
+	if (padded == NULL) return 0;
+
+	integral = vc_integral_new(padded->width, padded->height, 0);
+	if (integral == NULL)
+	{
+		vc_image_free(padded);
+		return 0;
+	}
+	vc_integral_compute(padded, integral);
+
+	// A janela de (x, y) é [x, x + 2r] x [y, y + 2r] na imagem com bordas
+	w = padded->width + 1;
+	for (y = 0; y < src->height; y++)
+	{
+		top = integral->sum + (long int)y * w;
+		bottom = integral->sum + (long int)(y + 2 * r + 1) * w;
+		for (x = 0; x < src->width; x++)
+		{
+			dst->data[(long int)y * dst->bytesperline + x] = (unsigned char)((bottom[x + 2 * r + 1] - bottom[x] - top[x + 2 * r + 1] + top[x]) / area);
+		}
+	}
+
+	vc_integral_free(integral);
+	vc_image_free(padded);
+
+	return 1;
+}
+
+/**
+ * @brief Filtro de mediana kernel x kernel com a política de borda indicada.
+ * Usa um histograma deslizante ao longo de cada linha (Huang): cada passo retira uma coluna e junta
+ * outra, e a mediana é atualizada a partir da anterior, pelo que o custo por pixel é O(kernel).
+ * @author lugon
+ * @param src Imagem de origem em escala de cinza.
+ * @param dst Imagem de destino (pode ser a própria src).
+ * @param kernel Tamanho do kernel (um kernel par comporta-se como o ímpar imediatamente inferior).
+ * @param policy VC_BORDER_CONSTANT (0 fora da imagem), VC_BORDER_REPLICATE ou VC_BORDER_REFLECT.
+ * @return int Retorna 1 se o filtro foi processado com sucesso, caso contrário retorna 0.
+ */
+int vc_gray_lowpass_median_filter_border(IVC* src, IVC* dst, int kernel, int policy)
+{
+	int r = (kernel - 1) / 2;
+	int k = 2 * r + 1;
+	int target = (k * k - 1) / 2;
+	int hist[256];
+	int x, y, i, med, below, bpl;
+	unsigned char *p, *col;
+	IVC* padded;
+
+	// Verificação de erros
+	if (!vc_gray_filter_check(src, dst) || (kernel < 1)) return 0;
+
+	padded = vc_image_pad(src, r, policy, 0);
+	if (padded == NULL) return 0;
+	bpl = padded->bytesperline;
+
+	for (y = 0; y < src->height; y++)
+	{
+		// Histograma da primeira janela da linha
+		memset(hist, 0, sizeof(hist));
+		for (i = 0; i < k; i++)
+		{
+			p = padded->data + (long int)(y + i) * bpl;
+			for (x = 0; x < k; x++) hist[p[x]]++;
+		}
+
+		// Mediana: menor nível med com (pixels < med) <= target < (pixels <= med)
+		med = 0;
+		below = 0;
+		while (below + hist[med] <= target) below += hist[med++];
+		dst->data[(long int)y * dst->bytesperline] = (unsigned char)med;
+
+		for (x = 1; x < src->width; x++)
+		{
+			// Retira a coluna x - 1 e junta a coluna x + 2r da imagem com bordas
+			col = padded->data + (long int)y * bpl;
+			for (i = 0; i < k; i++)
+			{
+				p = col + (long int)i * bpl;
+				hist[p[x - 1]]--;
+				if (p[x - 1] < med) below--;
+				hist[p[x + 2 * r]]++;
+				if (p[x + 2 * r] < med) below++;
+			}
+
+			while (below > target) below -= hist[--med];
+			while (below + hist[med] <= target) below += hist[med++];
+
+			dst->data[(long int)y * dst->bytesperline + x] = (unsigned char)med;
+		}
+	}
+
+	vc_image_free(padded);
+
+	return 1;
+}
+
+/**
+ * @brief Filtro de Gauss com pesos binomiais (kernel 3: 1 2 1 / 2 4 2 / 1 2 1, dividido por 16) e a
+ * política de borda indicada, em aritmética inteira e separável (uma passagem horizontal e uma vertical).
+ * O kernel de lado 2r + 1 usa as linhas C(2r, i) do triângulo de Pascal (sigma = sqrt(r / 2)).
+ * @author lugon
+ * @param src Imagem de origem em escala de cinza.
+ * @param dst Imagem de destino (pode ser a própria src).
+ * @param kernel Tamanho do kernel, de lado 2 * (kernel / 2) + 1, em [1, 25] (1 copia a imagem).
+ * @param policy VC_BORDER_CONSTANT (0 fora da imagem), VC_BORDER_REPLICATE ou VC_BORDER_REFLECT.
+ * @return int Retorna 1 se o filtro foi processado com sucesso, caso contrário retorna 0.
+ */
+int vc_gray_lowpass_gaussian_filter_border(IVC* src, IVC* dst, int kernel, int policy)
+{
+	int x, y, i, r = kernel / 2, weight[25];
+	unsigned int *rows, *h;
+	unsigned long long sum;
+	unsigned char *line, *out;
+	IVC* padded;
+
+	// Verificação de erros (com r <= 12, as somas cabem em 32 bits na horizontal e em 64 na vertical)
+	if (!vc_gray_filter_check(src, dst)) return 0;
+	if ((kernel < 1) || (r > 12)) return 0;
+
+	// Pesos binomiais C(2r, i)
+	weight[0] = 1;
+	for (i = 1; i <= 2 * r; i++) weight[i] = (int)(((long long)weight[i - 1] * (2 * r - i + 1)) / i);
+
+	padded = vc_image_pad(src, r, policy, 0);
+	rows = (unsigned int*)malloc((size_t)src->width * (src->height + 2 * r) * sizeof(unsigned int));
+	if ((padded == NULL) || (rows == NULL))
+	{
+		vc_image_free(padded);
+		free(rows);
+		return 0;
+	}
+
+	// Passagem horizontal, em todas as linhas da imagem com margem
+	for (y = 0; y < src->height + 2 * r; y++)
+	{
+		line = padded->data + (long int)y * padded->bytesperline;
+		h = rows + (long int)y * src->width;
+		for (x = 0; x < src->width; x++)
+		{
+			h[x] = 0;
+			for (i = 0; i <= 2 * r; i++) h[x] += (unsigned int)weight[i] * line[x + i];
+		}
+	}
+
+	// Passagem vertical; a soma dos pesos é 2^(4r)
+	for (y = 0; y < src->height; y++)
+	{
+		h = rows + (long int)y * src->width;
+		out = dst->data + (long int)y * dst->bytesperline;
+		for (x = 0; x < src->width; x++)
+		{
+			sum = 0;
+			for (i = 0; i <= 2 * r; i++) sum += (unsigned long long)weight[i] * h[x + (long int)i * src->width];
+			out[x] = (unsigned char)(sum >> (4 * r));
+		}
+	}
+
+	free(rows);
+	vc_image_free(padded);
+
+	return 1;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//      FUNÇÕES: CONTORNOS (SEGUIMENTO DE FRONTEIRA DE SUZUKI-ABE)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// As fronteiras são seguidas sobre uma cópia da imagem de etiquetas com um pixel de margem, em que
+// cada pixel guarda o estado do algoritmo (0 = fundo, 1 = frente por visitar, 2 = visitado, 3 =
+// visitado com o vizinho da direita de fundo). Uma fronteira exterior começa num pixel por visitar
+// com fundo à esquerda; a de um buraco num pixel não marcado com 3 com fundo à direita. Os pontos de
+// todos os contornos são escritos num único array do CSVC, que é reaproveitado entre chamadas.
+
+// Deslocamentos das 8 direções do código de cadeia (0 = E, sentido anti-horário no ecrã)
+static const int vc_chain_dx[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+static const int vc_chain_dy[8] = { 0, -1, -1, -1, 0, 1, 1, 1 };
+
+/**
+ * @brief Cria um conjunto de contornos vazio.
+ * @author lugon
+ * @return CSVC* Conjunto criado, ou NULL se faltar memória.
+ */
+CSVC* vc_contours_new(void)
+{
+	return (CSVC*)calloc(1, sizeof(CSVC));
+}
+
+/**
+ * @brief Liberta um conjunto de contornos.
+ * @author lugon
+ * @param set Conjunto a libertar (pode ser NULL).
+ * @return CSVC* Retorna sempre NULL.
+ */
+CSVC* vc_contours_free(CSVC* set)
+{
+	if (set != NULL)
+	{
+		free(set->contours);
+		free(set->points);
+		free(set);
+	}
+
+	return NULL;
+}
+
+// Acrescenta o ponto (x, y) ao último contorno, duplicando a capacidade do array se for preciso
+static int vc_contours_push(CSVC* set, int x, int y)
+{
+	int* grown;
+
+	if (set->npoints >= set->maxpoints)
+	{
+		grown = (int*)realloc(set->points, (size_t)2 * MAX(2 * set->maxpoints, 256) * sizeof(int));
+		if (grown == NULL) return 0;
+		set->points = grown;
+		set->maxpoints = MAX(2 * set->maxpoints, 256);
+	}
+
+	set->points[2 * set->npoints] = x;
+	set->points[2 * set->npoints + 1] = y;
+	set->npoints++;
+	set->contours[set->ncontours - 1].npoints++;
+
+	return 1;
+}
+
+// Segue a fronteira que começa no pixel i0 = (x0, y0) da imagem com margem (passo stride) e
+// acrescenta-a ao conjunto. Se compress != 0, só os pontos onde a direção muda são guardados.
+// Retorna 0 se faltar memória.
+static int vc_contour_follow(CSVC* set, unsigned char* img, int stride, int x0, int y0, int hole, int compress)
+{
+	long int delta[16], i0, i1, i3, i4;
+	int s, send, prevs, x = x0, y = y0, xmax = x0, ymax = y0, straight = 0, diagonal = 0;
+	long int p0 = (long int)(y0 + 1) * stride + x0 + 1;
+	CVC* c;
+
+	if (set->ncontours >= set->maxcontours)
+	{
+		c = (CVC*)realloc(set->contours, (size_t)MAX(2 * set->maxcontours, 16) * sizeof(CVC));
+		if (c == NULL) return 0;
+		set->contours = c;
+		set->maxcontours = MAX(2 * set->maxcontours, 16);
+	}
+	c = &set->contours[set->ncontours++];
+	c->hole = hole;
+	c->first = set->npoints;
+	c->npoints = 0;
+	c->x = x0;
+	c->y = y0;
+
+	for (s = 0; s < 16; s++) delta[s] = vc_chain_dy[s & 7] * (long int)stride + vc_chain_dx[s & 7];
+
+	// Procura, no sentido horário a partir do vizinho de fundo, o primeiro vizinho de frente
+	i0 = p0;
+	send = s = hole ? 0 : 4;
+	do
+	{
+		s = (s - 1) & 7;
+		i1 = i0 + delta[s];
+	} while ((img[i1] == 0) && (s != send));
+
+	if (s == send)
+	{
+		// Pixel isolado
+		img[i0] = 3;
+		if (!vc_contours_push(set, x0, y0)) return 0;
+	}
+	else
+	{
+		i3 = i0;
+		prevs = s ^ 4;
+
+		for (;;)
+		{
+			// Procura no sentido anti-horário, a partir do pixel anterior, o próximo pixel da fronteira
+			send = s;
+			do
+			{
+				i4 = i3 + delta[++s];
+			} while (img[i4] == 0);
+			s &= 7;
+
+			// O vizinho da direita é de fundo se foi examinado (a procura passou pela direção 0)
+			if ((unsigned int)(s - 1) < (unsigned int)send) img[i3] = 3;
+			else if (img[i3] == 1) img[i3] = 2;
+
+			if ((s != prevs) || !compress)
+			{
+				if (!vc_contours_push(set, x, y)) return 0;
+				prevs = s;
+			}
+
+			if (s & 1) diagonal++;
+			else straight++;
+			x += vc_chain_dx[s];
+			y += vc_chain_dy[s];
+			if (c->x > x) c->x = x;
+			if (c->y > y) c->y = y;
+			if (xmax < x) xmax = x;
+			if (ymax < y) ymax = y;
+
+			if ((i4 == i0) && (i3 == i1)) break;
+
+			i3 = i4;
+			s = (s + 4) & 7;
+		}
+	}
+
+	c->width = xmax - c->x + 1;
+	c->height = ymax - c->y + 1;
+	c->perimeter = (float)straight + 1.41421356f * (float)diagonal;
+
+	return 1;
+}
+
+/**
+ * @brief Extrai os contornos dos blobs de uma imagem de etiquetas (seguimento de fronteira de Suzuki-Abe).
+ * Os contornos são encontrados por ordem de varrimento; o contorno exterior de cada blob tem a mesma
+ * caixa delimitadora que o blob. Os pontos de cada contorno (no sentido anti-horário no ecrã, a partir
+ * do pixel mais acima e à esquerda) ficam no array do conjunto, sem alocações por ponto; o conjunto
+ * é esvaziado no início e a memória já alocada é reaproveitada.
+ * @author lugon
+ * @param set Conjunto onde os contornos são escritos.
+ * @param labels Etiquetas, width x height (0 = fundo), por exemplo de vc_binary_blob_labelling32.
+ * @param width Largura da imagem de etiquetas.
+ * @param height Altura da imagem de etiquetas.
+ * @param holes Se != 0, também são guardados os contornos dos buracos.
+ * @param compress Se != 0, só são guardados os pontos onde a direção muda (polígono); senão, todos os pixels da fronteira.
+ * @return int Número de contornos, ou -1 em caso de erro.
+ */
+int vc_contours_trace(CSVC* set, int* labels, int width, int height, int holes, int compress)
+{
+	unsigned char *img, *p;
+	int x, y, stride = width + 2, *row;
+
+	// Verificação de erros
+	if ((set == NULL) || (labels == NULL) || (width <= 0) || (height <= 0)) return -1;
+
+	set->ncontours = 0;
+	set->npoints = 0;
+
+	img = (unsigned char*)calloc((size_t)stride * (height + 2), 1);
+	if (img == NULL) return -1;
+
+	for (y = 0; y < height; y++)
+	{
+		row = labels + (long int)y * width;
+		p = img + (long int)(y + 1) * stride + 1;
+		for (x = 0; x < width; x++) p[x] = (row[x] != 0);
+	}
+
+	for (y = 0; y < height; y++)
+	{
+		p = img + (long int)(y + 1) * stride + 1;
+		for (x = 0; x < width; x++)
+		{
+			if (p[x] == 0) continue;
+
+			// Sem buracos pedidos, as suas fronteiras são seguidas na mesma (para marcar os pixels, que
+			// de outro modo seriam tomados por inícios de fronteiras exteriores), mas não são guardadas
+			if ((p[x] == 1) && (p[x - 1] == 0))
+			{
+				if (!vc_contour_follow(set, img, stride, x, y, 0, compress)) break;
+			}
+			else if ((p[x] != 3) && (p[x + 1] == 0))
+			{
+				if (!vc_contour_follow(set, img, stride, x, y, 1, compress)) break;
+				if (!holes)
+				{
+					set->ncontours--;
+					set->npoints = set->contours[set->ncontours].first;
+					continue;
+				}
+			}
+			else continue;
+
+			set->contours[set->ncontours - 1].label = labels[(long int)y * width + x];
+		}
+		if (x < width) break;
+	}
+
+	free(img);
+
+	return (y < height) ? -1 : set->ncontours;
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//      FUNÇÕES: MOMENTOS E CAIXAS DELIMITADORAS ORIENTADAS
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Os momentos brutos de cada blob são acumulados na mesma passagem que a área e o centro de gravidade
+// (vc_blob_acc); os centrais, a orientação e os eixos são derivados deles no fim. Como os momentos
+// brutos são somas, dois blobs podem ser juntados sem voltar a percorrer a imagem.
+
+/**
+ * @brief Junta o blob src ao blob dst (por exemplo, partes da mesma resistência).
+ * A área, o perímetro e os momentos brutos são somados, a caixa delimitadora é a união das duas,
+ * e o centro de gravidade, os momentos centrais, a orientação e os eixos são recalculados.
+ * @author lugon
+ * @param dst Blob que recebe a junção (mantém a etiqueta).
+ * @param src Blob a juntar.
+ * @return int Retorna 1 se a junção foi feita, 0 caso contrário.
+ */
+int vc_blob_merge(OVC* dst, OVC* src)
+{
+	int x1, y1;
+
+	// Verificação de erros
+	if ((dst == NULL) || (src == NULL)) return 0;
+	if (src->area <= 0) return 1;
+	if (dst->area <= 0)
+	{
+		x1 = dst->label;
+		*dst = *src;
+		dst->label = x1;
+		return 1;
+	}
+
+	x1 = MAX(dst->x + dst->width, src->x + src->width);
+	y1 = MAX(dst->y + dst->height, src->y + src->height);
+	dst->x = MIN(dst->x, src->x);
+	dst->y = MIN(dst->y, src->y);
+	dst->width = x1 - dst->x;
+	dst->height = y1 - dst->y;
+	dst->area += src->area;
+	dst->perimeter += src->perimeter;
+
+	dst->moments.m00 += src->moments.m00;
+	dst->moments.m10 += src->moments.m10;
+	dst->moments.m01 += src->moments.m01;
+	dst->moments.m20 += src->moments.m20;
+	dst->moments.m11 += src->moments.m11;
+	dst->moments.m02 += src->moments.m02;
+	dst->moments.m30 += src->moments.m30;
+	dst->moments.m21 += src->moments.m21;
+	dst->moments.m12 += src->moments.m12;
+	dst->moments.m03 += src->moments.m03;
+
+	dst->xc = (int)(dst->moments.m10 / dst->moments.m00);
+	dst->yc = (int)(dst->moments.m01 / dst->moments.m00);
+	vc_blob_moments_update(dst);
+
+	return 1;
+}
+
+/**
+ * @brief Caixa delimitadora orientada de um blob: o retângulo com os mesmos momentos até à 2ª ordem.
+ * O retângulo está centrado no centro de gravidade exato, com o lado maior segundo a orientação do blob.
+ * Cada lado mede sqrt(12 * variância + 1) (a variância de um pixel é 1/12), pelo que a caixa coincide
+ * com o blob quando este é um retângulo alinhado com os eixos.
+ * @author lugon
+ * @param blob Blob com os momentos calculados.
+ * @param corners Cantos (x0, y0, ..., x3, y3), por ordem, a partir do canto de trás do lado -v.
+ * @param length Se != NULL, recebe o comprimento (lado segundo o eixo maior).
+ * @param thickness Se != NULL, recebe a largura (lado segundo o eixo menor).
+ * @return int Retorna 1 se a caixa foi calculada, 0 se o blob está vazio.
+ */
+int vc_blob_oriented_box(OVC* blob, float corners[8], float* length, float* thickness)
+{
+	double xm, ym, ux, uy, hl, hw, l1, l2;
+
+	// Verificação de erros
+	if ((blob == NULL) || (corners == NULL) || (blob->moments.m00 <= 0.0)) return 0;
+
+	xm = blob->moments.m10 / blob->moments.m00;
+	ym = blob->moments.m01 / blob->moments.m00;
+	ux = cos(blob->angle);
+	uy = sin(blob->angle);
+
+	// Os eixos da elipse medem 4 * sqrt(variância)
+	l1 = sqrt(12.0 * (blob->major / 4.0) * (blob->major / 4.0) + 1.0);
+	l2 = sqrt(12.0 * (blob->minor / 4.0) * (blob->minor / 4.0) + 1.0);
+	hl = l1 / 2.0;
+	hw = l2 / 2.0;
+
+	corners[0] = (float)(xm - hl * ux + hw * uy);
+	corners[1] = (float)(ym - hl * uy - hw * ux);
+	corners[2] = (float)(xm + hl * ux + hw * uy);
+	corners[3] = (float)(ym + hl * uy - hw * ux);
+	corners[4] = (float)(xm + hl * ux - hw * uy);
+	corners[5] = (float)(ym + hl * uy + hw * ux);
+	corners[6] = (float)(xm - hl * ux - hw * uy);
+	corners[7] = (float)(ym - hl * uy + hw * ux);
+
+	if (length != NULL) *length = (float)l1;
+	if (thickness != NULL) *thickness = (float)l2;
+
+	return 1;
+}
+
+/**
+ * @brief Calcula os 7 momentos invariantes de Hu de um blob (invariantes a translação, escala e rotação).
+ * @author lugon
+ * @param blob Blob com os momentos calculados.
+ * @param hu Array de saída com os 7 momentos.
+ * @return int Retorna 1 se os momentos foram calculados, 0 se o blob está vazio.
+ */
+int vc_blob_hu_moments(OVC* blob, double hu[7])
+{
+	MVC* m;
+	double s2, s3, n20, n11, n02, n30, n21, n12, n03, a, b, c, d;
+
+	// Verificação de erros
+	if ((blob == NULL) || (hu == NULL) || (blob->moments.m00 <= 0.0)) return 0;
+
+	// Momentos centrais normalizados: eta_pq = mu_pq / m00^(1 + (p + q) / 2)
+	m = &blob->moments;
+	s2 = 1.0 / (m->m00 * m->m00);
+	s3 = s2 / sqrt(m->m00);
+	n20 = m->mu20 * s2;
+	n11 = m->mu11 * s2;
+	n02 = m->mu02 * s2;
+	n30 = m->mu30 * s3;
+	n21 = m->mu21 * s3;
+	n12 = m->mu12 * s3;
+	n03 = m->mu03 * s3;
+
+	a = n30 + n12;
+	b = n21 + n03;
+	c = n30 - 3.0 * n12;
+	d = 3.0 * n21 - n03;
+
+	hu[0] = n20 + n02;
+	hu[1] = (n20 - n02) * (n20 - n02) + 4.0 * n11 * n11;
+	hu[2] = c * c + d * d;
+	hu[3] = a * a + b * b;
+	hu[4] = c * a * (a * a - 3.0 * b * b) + d * b * (3.0 * a * a - b * b);
+	hu[5] = (n20 - n02) * (a * a - b * b) + 4.0 * n11 * a * b;
+	hu[6] = d * a * (a * a - 3.0 * b * b) - c * b * (3.0 * a * a - b * b);
+
+	return 1;
+}
@@ -14,14 +14,124 @@ typedef struct {
 } IVC;
 
 
+// Momentos de um blob até à 3ª ordem; os centrais são relativos ao centro de gravidade exato
+typedef struct {
+	double m00, m10, m01, m20, m11, m02, m30, m21, m12, m03;	// Momentos brutos
+	double mu20, mu11, mu02, mu30, mu21, mu12, mu03;			// Momentos centrais
+} MVC;
+
 typedef struct {
 	int x, y, width, height;	// Caixa Delimitadora (Bounding Box)
 	int area;					// �rea
 	int xc, yc;					// Centro-de-massa
 	int perimeter;				// Per�metro
 	int label;					// Etiqueta
+	MVC moments;				// Momentos
+	float angle;				// Orientação do eixo maior, em radianos, em ]-pi/2, pi/2] (eixo y para baixo)
+	float major, minor;			// Eixos da elipse com os mesmos momentos de 2ª ordem
 } OVC;
 
+// Tabela de consulta (LUT) de uma cadeia de operações pontuais em escala de cinza
+typedef struct {
+	unsigned char table[256];		// Nível de saída para cada nível de entrada
+} LVC;
+
+// Paleta de cores (colormap) com 256 entradas, indexada pelo nível de cinzento
+typedef struct {
+	unsigned char color[256][4];	// (R, G, B, A) de cada nível; A = opacidade usada na mistura
+} PVC;
+
+// Imagem integral (summed-area table) de uma imagem em escala de cinza, com (width+1) x (height+1) entradas.
+// sum[y * (width+1) + x] = soma dos pixels de [0, x) x [0, y). As somas de 32 bits podem dar a volta em
+// imagens muito grandes, mas a diferença usada por um retângulo continua exata (aritmética módulo 2^32)
+// desde que a soma do próprio retângulo caiba em 32 bits (até 16 milhões de pixels).
+typedef struct {
+	int width, height;				// Dimensões da imagem de origem
+	unsigned int *sum;				// Somas dos níveis
+	unsigned long long *sqsum;		// Somas dos quadrados dos níveis (NULL se não foram pedidas)
+} SVC;
+
+// Intervalo de segmentação HSV. Se minHue > maxHue, o intervalo de Hue dá a volta pelo 0
+// (por exemplo, vermelho: minHue = 170, maxHue = 10 na escala do OpenCV).
+typedef struct {
+	unsigned char minHue, maxHue;
+	unsigned char minSaturation, maxSaturation;
+	unsigned char minValue, maxValue;
+} RVC;
+
+// Segmento (run) horizontal de pixels de frente: colunas [xstart, xend] da linha y
+typedef struct {
+	int y, xstart, xend;
+	int label;				// Índice do blob (em blobs[]) a que o segmento pertence
+} RLVC;
+
+// Máscara binária compactada: um bit por pixel, 64 pixels por palavra.
+// O pixel (x, y) é o bit (x % 64) de data[y * wordsperline + x / 64]; os bits além de width são sempre 0.
+typedef struct {
+	unsigned long long *data;
+	int width, height;
+	int wordsperline;		// (width + 63) / 64
+} BVC;
+
+// Elemento estruturante binário para a morfologia, com a origem no centro
+typedef struct {
+	unsigned char *data;	// width x height; 1 = pertence ao elemento
+	int width, height;		// Dimensões ímpares
+} EVC;
+
+// Contorno de um blob. Os pontos (x, y) estão em points[2 * first .. 2 * (first + npoints) - 1] do CSVC
+typedef struct {
+	int label;				// Etiqueta do blob
+	int hole;				// 0 = contorno exterior, 1 = contorno de um buraco
+	int first, npoints;
+	int x, y, width, height;	// Caixa delimitadora
+	float perimeter;		// Comprimento da cadeia: 1 por passo reto, sqrt(2) por passo diagonal
+} CVC;
+
+// Conjunto de contornos, com os pontos de todos num único array (x0, y0, x1, y1, ...)
+typedef struct {
+	CVC *contours;
+	int ncontours, maxcontours;
+	int *points;
+	int npoints, maxpoints;
+} CSVC;
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//            ORDEM DOS CANAIS E ESCALA DO MATIZ (HUE)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Os kernels de cor são instanciados em tempo de compilação para cada
+// ordem de canais (RGB ou BGR, a ordem entregue pelo OpenCV) e para cada
+// escala de Hue, pelo que não é necessária nenhuma passagem de reordenação.
+#define VC_HUE_SCALE_VC		255		// Hue em [0,255] (escala original do vc)
+#define VC_HUE_SCALE_OPENCV	180		// Hue em [0,180] (escala do OpenCV)
+
+// Métodos de seleção automática do threshold (vc_gray_to_binary_auto)
+#define VC_THRESHOLD_MEAN		0		// Média global
+#define VC_THRESHOLD_OTSU		1		// Otsu (máxima variância entre classes)
+#define VC_THRESHOLD_TRIANGLE	2		// Triângulo (Zack), adequado a histogramas com um pico dominante
+#define VC_MULTI_OTSU_MAX		4		// Número máximo de thresholds do Otsu multinível (custo O(n * 256^2) por histograma)
+
+// Número máximo de intervalos de vc_hsv_segmentation_ranges (um bit por intervalo em cada pixel)
+#define VC_HSV_MAX_RANGES	8
+
+// Operações de vc_binary_morphology_sequence
+#define VC_MORPH_ERODE		0
+#define VC_MORPH_DILATE		1
+
+// Políticas de borda dos filtros de vizinhança (vc_image_pad e funções *_border)
+#define VC_BORDER_CONSTANT		0		// Valor constante:  vvv|abcd|vvv
+#define VC_BORDER_REPLICATE		1		// Repete a margem:  aaa|abcd|ddd
+#define VC_BORDER_REFLECT		2		// Espelho sem repetir a margem: dcb|abcd|cba
+#define VC_BORDER_DEFAULT		VC_BORDER_REPLICATE	// Política dos filtros sem argumento de borda
+
+// Número máximo de níveis de uma pirâmide (nível 0 = resolução original)
+#define VC_PYRAMID_MAX_LEVELS	8
+
+// Paletas predefinidas para vc_palette_builtin()
+#define VC_COLORMAP_HEAT	0		// Azul -> ciano -> verde -> amarelo -> vermelho (vc_scale_gray_to_rgb)
+#define VC_COLORMAP_JET		1		// Jet (azul escuro -> vermelho escuro)
+#define VC_COLORMAP_LABEL	2		// Cores distintas por etiqueta; etiqueta 0 transparente
+
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 //                    PROTÓTIPOS DE FUNÇÕES
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -33,17 +143,32 @@ IVC *vc_read_image(char *filename);
 int vc_write_image(char *filename, IVC *image);
 int vc_gray_negative(IVC* srcdst);
 int vc_rgb_negative(IVC* srcdst);
+// O negativo não depende da ordem dos canais
+#define vc_bgr_negative(srcdst) vc_rgb_negative(srcdst)
 int vc_rgb_get_red_gray(IVC* srcdst);
 int vc_rgb_get_green_gray(IVC* srcdst);
 int vc_rgb_get_blue_gray(IVC* srcdst);
+int vc_bgr_get_red_gray(IVC* srcdst);
+int vc_bgr_get_green_gray(IVC* srcdst);
+int vc_bgr_get_blue_gray(IVC* srcdst);
 int vc_rgb_to_hsv(IVC* src, IVC* dst);
+int vc_bgr_to_hsv(IVC* src, IVC* dst);
+int vc_rgb_to_hsv_180(IVC* src, IVC* dst);
+int vc_bgr_to_hsv_180(IVC* src, IVC* dst);
 int vc_rgb_to_gray(IVC* src, IVC* dst);
+int vc_bgr_to_gray(IVC* src, IVC* dst);
 int vc_scale_gray_to_rgb(IVC* src, IVC* dst);
+int vc_palette_builtin(PVC* palette, int colormap);
+void vc_palette_to_bgr(PVC* palette);
+int vc_gray_to_colormap(IVC* src, IVC* dst, PVC* palette);
+int vc_gray_to_colormap_blend(IVC* src, IVC* base, IVC* dst, PVC* palette, int alpha);
 int vc_gray_to_binary(IVC *src, IVC *dst, int threshold);
 int vc_gray_to_binary_global_mean(IVC* src, IVC* dst);
 int vc_binary_dilate(IVC* src, IVC* dst, int kernel);
 int vc_binary_erode(IVC* src, IVC* dst, int kernel);
 OVC* vc_binary_blob_labelling(IVC *src, IVC *dst, int *nlabels);
+OVC* vc_binary_blob_labelling32(IVC* src, int* labels, int* nlabels);
+int vc_binary_blob_labelling_parallel(IVC* src, int* labels, int nstrips, OVC** blobs);
 int vc_binary_blob_info(IVC *src, OVC *blobs, int nblobs);
 int vc_gray_edge_prewitt(IVC *src, IVC *dst, float th);
 int vc_gray_edge_sobel(IVC* src, IVC* dst, float th);
@@ -55,4 +180,105 @@ int vc_gray_lowpass_mean_filter(IVC* src, IVC* dst, int kernel);
 int vc_gray_lowpass_median_filter(IVC* src, IVC* dst, int kernel);
 int vc_draw_boundingbox(IVC *srcdst, OVC *blob);
 int vc_draw_centerofgravity(IVC *srcdst, OVC *blob);
-int vc_hsv_segmentation(IVC* src, IVC* dst, unsigned char minHue, unsigned char maxHue, unsigned char minSaturation, unsigned char maxSaturation, unsigned char minValue, unsigned char maxValue);
\ No newline at end of file
+int vc_hsv_segmentation(IVC* src, IVC* dst, unsigned char minHue, unsigned char maxHue, unsigned char minSaturation, unsigned char maxSaturation, unsigned char minValue, unsigned char maxValue);
+int vc_hsv_segmentation_180(IVC* src, IVC* dst, unsigned char minHue, unsigned char maxHue, unsigned char minSaturation, unsigned char maxSaturation, unsigned char minValue, unsigned char maxValue);
+// FUNÇÕES: PIRÂMIDE DE IMAGENS E REGIÕES DE INTERESSE
+IVC* vc_image_crop(IVC* src, int x, int y, int width, int height);
+int vc_pyramid_down(IVC* src, IVC* dst);
+int vc_pyramid_down_gaussian(IVC* src, IVC* dst);
+int vc_pyramid_build(IVC* src, IVC* levels[], int nlevels, int gaussian);
+void vc_pyramid_free(IVC* levels[], int nlevels);
+// FUNÇÕES: OPERAÇÕES PONTUAIS COMPOSTAS NUMA TABELA DE CONSULTA (LUT)
+void vc_lut_identity(LVC* lut);
+void vc_lut_compose(LVC* lut, LVC* next);
+void vc_lut_negative(LVC* lut);
+void vc_lut_threshold(LVC* lut, int threshold);
+void vc_lut_binary_negative(LVC* lut);
+int vc_lut_equalization(LVC* lut, IVC* src);
+int vc_lut_equalization_histogram(LVC* lut, int hist[256]);
+int vc_gray_apply_lut(IVC* src, IVC* dst, LVC* lut);
+// FUNÇÕES: HISTOGRAMA E THRESHOLD AUTOMÁTICO
+int vc_gray_histogram(IVC* src, int hist[256]);
+int vc_histogram_threshold_mean(int hist[256]);
+int vc_histogram_threshold_otsu(int hist[256]);
+int vc_histogram_threshold_triangle(int hist[256]);
+int vc_histogram_threshold_multi_otsu(int hist[256], int thresholds[], int nthresholds);
+int vc_gray_to_binary_auto(IVC* src, IVC* dst, int method, int* threshold);
+int vc_gray_to_multilevel_otsu(IVC* src, IVC* dst, int thresholds[], int nthresholds);
+// FUNÇÕES: FILTROS DE MÍNIMO/MÁXIMO (VAN HERK/GIL-WERMAN)
+int vc_gray_min_max_filter(IVC* src, IVC* dstmin, IVC* dstmax, int kernel);
+int vc_gray_to_binary_midpoint(IVC* src, IVC* dst, int kernel, unsigned char foreground);
+// FUNÇÕES: IMAGEM INTEGRAL E THRESHOLDS ADAPTATIVOS
+SVC* vc_integral_new(int width, int height, int squared);
+SVC* vc_integral_free(SVC* integral);
+int vc_integral_compute(IVC* src, SVC* integral);
+unsigned int vc_integral_sum(SVC* integral, int x, int y, int width, int height);
+unsigned long long vc_integral_sqsum(SVC* integral, int x, int y, int width, int height);
+float vc_integral_mean(SVC* integral, int x, int y, int width, int height);
+float vc_integral_variance(SVC* integral, int x, int y, int width, int height);
+int vc_gray_to_binary_niblack(IVC* src, IVC* dst, int kernel, float k);
+int vc_gray_to_binary_sauvola(IVC* src, IVC* dst, int kernel, float k, float r);
+// FUNÇÕES: SEGMENTAÇÃO HSV MULTI-INTERVALO (UM BIT POR INTERVALO)
+int vc_hsv_segmentation_ranges(IVC* src, IVC* dst, RVC ranges[], int nranges, int counts[]);
+int vc_hsv_segmentation_ranges_180(IVC* src, IVC* dst, RVC ranges[], int nranges, int counts[]);
+int vc_bitplane_to_binary(IVC* src, IVC* dst, unsigned char bits);
+// FUNÇÕES: SEGMENTAÇÃO EM SEGMENTOS (RUN-LENGTH) E CAIXAS DELIMITADORAS
+int vc_binary_runs(IVC* src, RLVC runs[], OVC blobs[], int maxruns, int* nruns, int* nblobs);
+OVC* vc_binary_blob_labelling_runs(IVC* src, int* nlabels, RLVC** runs, int* nruns);
+int vc_hsv_segmentation_runs(IVC* src, RVC ranges[], int nranges, RLVC runs[], OVC blobs[], int maxruns, int* nruns, int* nblobs);
+int vc_hsv_segmentation_runs_180(IVC* src, RVC ranges[], int nranges, RLVC runs[], OVC blobs[], int maxruns, int* nruns, int* nblobs);
+int vc_runs_to_binary(IVC* dst, RLVC runs[], int nruns);
+// FUNÇÕES: DETEÇÃO DE ALTERAÇÕES POR BLOCOS
+int vc_image_tile_changes(IVC* src, IVC* prev, int tilesize, int threshold, unsigned char dirty[], int* ndirty);
+// FUNÇÕES: MORFOLOGIA BINÁRIA EM MÁSCARAS DE BITS
+BVC* vc_bitmask_new(int width, int height);
+BVC* vc_bitmask_free(BVC* mask);
+int vc_binary_to_bitmask(IVC* src, BVC* dst, unsigned char threshold);
+int vc_bitmask_to_binary(BVC* src, IVC* dst);
+int vc_bitmask_dilate(BVC* src, BVC* dst, int kernel);
+int vc_bitmask_erode(BVC* src, BVC* dst, int kernel);
+int vc_binary_morphology_sequence(IVC* src, IVC* dst, int ops[], int kernels[], int nops);
+int vc_binary_open(IVC* src, IVC* dst, int kernel);
+int vc_binary_close(IVC* src, IVC* dst, int kernel);
+// FUNÇÕES: ELEMENTOS ESTRUTURANTES ARBITRÁRIOS
+EVC* vc_se_new(int width, int height);
+EVC* vc_se_free(EVC* se);
+EVC* vc_se_rect(int width, int height);
+EVC* vc_se_cross(int size);
+EVC* vc_se_disk(int radius);
+EVC* vc_se_line(int length, float angle);
+int vc_bitmask_dilate_se(BVC* src, BVC* dst, EVC* se);
+int vc_bitmask_erode_se(BVC* src, BVC* dst, EVC* se);
+int vc_binary_dilate_se(IVC* src, IVC* dst, EVC* se);
+int vc_binary_erode_se(IVC* src, IVC* dst, EVC* se);
+// FUNÇÕES: TRANSFORMADA DE DISTÂNCIA EUCLIDIANA
+int vc_binary_distance_transform(IVC* src, float* dist);
+int vc_binary_distance_transform_u16(IVC* src, unsigned short* dist);
+int vc_binary_dilate_radius(IVC* src, IVC* dst, float radius);
+int vc_binary_erode_radius(IVC* src, IVC* dst, float radius);
+int vc_binary_blob_thickness(IVC* labels, OVC* blobs, int nblobs, float* maxthickness, float* meanthickness);
+// FUNÇÕES: MORFOLOGIA EM ESCALA DE CINZA
+int vc_gray_erode(IVC* src, IVC* dst, int kernel);
+int vc_gray_dilate(IVC* src, IVC* dst, int kernel);
+int vc_gray_open(IVC* src, IVC* dst, int kernel);
+int vc_gray_close(IVC* src, IVC* dst, int kernel);
+int vc_gray_tophat_white(IVC* src, IVC* dst, int kernel);
+int vc_gray_tophat_black(IVC* src, IVC* dst, int kernel);
+// FUNÇÕES: RECONSTRUÇÃO MORFOLÓGICA E PREENCHIMENTO DE BURACOS
+int vc_gray_reconstruct(IVC* marker, IVC* mask, IVC* dst);
+int vc_binary_reconstruct(IVC* marker, IVC* mask, IVC* dst);
+int vc_binary_fill_holes(IVC* src, IVC* dst);
+// FUNÇÕES: BORDAS PRÉ-PREENCHIDAS PARA FILTROS DE VIZINHANÇA
+IVC* vc_image_pad(IVC* src, int border, int policy, unsigned char value);
+int vc_image_fill_border(IVC* image, int border, int policy, unsigned char value);
+int vc_gray_lowpass_mean_filter_border(IVC* src, IVC* dst, int kernel, int policy);
+int vc_gray_lowpass_median_filter_border(IVC* src, IVC* dst, int kernel, int policy);
+int vc_gray_lowpass_gaussian_filter_border(IVC* src, IVC* dst, int kernel, int policy);
+// FUNÇÕES: CONTORNOS (SEGUIMENTO DE FRONTEIRA DE SUZUKI-ABE)
+CSVC* vc_contours_new(void);
+CSVC* vc_contours_free(CSVC* set);
+int vc_contours_trace(CSVC* set, int* labels, int width, int height, int holes, int compress);
+// FUNÇÕES: MOMENTOS E CAIXAS DELIMITADORAS ORIENTADAS
+int vc_blob_merge(OVC* dst, OVC* src);
+int vc_blob_oriented_box(OVC* blob, float corners[8], float* length, float* thickness);
+int vc_blob_hu_moments(OVC* blob, double hu[7]);